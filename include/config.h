@@ -1,8 +1,305 @@
 #pragma once
 #include "types.h"
 #include <algorithm>
+#include <bit>
+#include <limits>
 
-inline constexpr std::size_t NumClasses = 9;
-inline constexpr std::array<SizeClassId, NumClasses> sizes{16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
-inline constexpr std::size_t page_size = 64 * 1024; //64KB
-inline constexpr uint8_t blocks_per_bin = 128;
+// Tuning policy of a basic_slab (and of its PagePool, ThreadCache and TransferCache).
+// A policy is a struct of constants; config_traits<Config> derives the class tables from it
+// at compile time, so differently tuned slabs live side by side in one process with nothing
+// looked up at runtime. Custom policies derive from default_config and shadow what they change.
+struct default_config {
+    // size classes: class_small_step apart up to class_small_max, then class_steps_per_doubling
+    // geometric steps per power of two up to max_small_size (16..128 by 16, 160, 192, 224, 256,
+    // 320, ...). Every class is a multiple of class_small_step.
+    static constexpr std::size_t class_small_step = 16;
+    static constexpr std::size_t class_small_max = 128;
+    static constexpr std::size_t class_steps_per_doubling = 4;
+    static constexpr std::size_t max_small_size = 4096;
+
+    // slab size: every page of small blocks, and the unit large spans are counted in
+    static constexpr std::size_t page_size = 64 * 1024; //64KB
+
+    // blocks moved at once for a class of this size: about refill_bytes worth, so small
+    // classes take a quarter page per trip to the pool lock and the largest a few blocks
+    // instead of several pages. Sizes pool refills, batches released by an over-full thread
+    // cache and transfer-cache entries.
+    static constexpr std::size_t refill_bytes = 32 * 1024;
+    static constexpr std::uint32_t refill_batch(std::size_t size) noexcept {
+        return static_cast<std::uint32_t>(std::clamp<std::size_t>(refill_bytes / size, 4, 1024));
+    }
+    // adaptive refills: a thread's pool refills of a class start at refill_start_div of the
+    // batch, double while it keeps missing on the class (slow start) up to the batch, and
+    // halve when the class sat idle for refill_idle_misses of the thread's misses elsewhere
+    // or keeps overflowing. Off: every refill is a whole batch.
+    static constexpr bool adaptive_refill = true;
+    static constexpr std::uint32_t refill_start_div = 8;
+    static constexpr std::uint32_t refill_idle_misses = 64;
+
+    // thread cache limits: each class starts at one batch and grows by a batch per miss
+    // (slow start) up to cache_max_batches, while the thread's summed limits fit its byte
+    // budget = total_thread_cache_bytes / active threads, clamped to [min, max]
+    static constexpr std::uint32_t cache_max_batches = 8;
+    static constexpr std::size_t total_thread_cache_bytes = 64 * 1024 * 1024;
+    static constexpr std::size_t min_thread_cache_bytes = 256 * 1024;
+    static constexpr std::size_t max_thread_cache_bytes = 8 * 1024 * 1024;
+
+    // transfer cache: whole batches kept per class, up to transfer_cache_bytes and between 2
+    // and transfer_slots batches
+    static constexpr std::size_t transfer_cache_bytes = 4 * 1024 * 1024;
+    static constexpr std::size_t transfer_slots = 64;
+
+    // fully free pages kept backed by the page pool before it madvises the rest away
+    static constexpr std::size_t retain_empty_pages = 16;
+
+    // large spans (up to max_span_pages): each thread keeps freed ones up to large_cache_bytes
+    // and the page pool keeps retain_large_pages of them backed
+    static constexpr std::size_t large_cache_bytes = 2 * 1024 * 1024;
+    static constexpr std::size_t retain_large_pages = 64;
+
+    // freed direct mappings (large objects past max_span_pages) kept resident for reuse: up to
+    // large_map_cache of them and map_cache_bytes in all (eight 1MB spans' worth); a larger
+    // mapping is unmapped as soon as it is freed
+    static constexpr std::size_t large_map_cache = 8;
+    static constexpr std::size_t map_cache_bytes = 8 * 1024 * 1024;
+
+    // free lists per CPU instead of per thread (see CpuCaches), each class holding up to
+    // cache_max_batches batches; threads then never register and hold no blocks of their own
+    static constexpr bool per_cpu_caches = false;
+
+    // return rings: a freeing thread that hands return_ring_after full remote batches in a
+    // row to one owner (or asks with pair_with) gets a ReturnRing of return_ring_slots
+    // into that owner's cache, which takes up to return_rings of them. 0 turns rings off.
+    static constexpr std::uint32_t return_rings = 4;
+    static constexpr std::uint32_t return_ring_slots = 512;
+    static constexpr std::uint32_t return_ring_after = 4;
+
+    // remote draining: an owner takes returned blocks (inbox and rings) drain_step at a time,
+    // so no allocation walks a long chain at once. A miss drains until its class has a block,
+    // for up to drain_miss_steps steps; every drain_interval runtime frees onto its cache the
+    // owner also reads the approximate pending count and drains a step once drain_threshold
+    // blocks wait, so a thread that never misses still takes its blocks back.
+    // slab::maintain() drains everything.
+    static constexpr std::uint32_t drain_step = 32;
+    static constexpr std::uint32_t drain_miss_steps = 4;
+    static constexpr std::uint32_t drain_interval = 64;
+    static constexpr std::uint32_t drain_threshold = 32;
+
+    // remote frees are buffered per owner in remote_buffers lists and spliced into its inbox
+    // remote_batch at a time
+    static constexpr std::size_t remote_buffers = 8;
+    static constexpr std::uint32_t remote_batch = 32;
+
+    // adopt mode: a freeing thread keeps a remote block only while it caches fewer than
+    // this many blocks of that class, bounding how much memory drifts toward consumers
+    static constexpr std::uint16_t adopt_max_cached = 256;
+};
+
+// The default policy with per-CPU caches, for processes with many more threads than cores.
+struct per_cpu_config : default_config {
+    static constexpr bool per_cpu_caches = true;
+};
+
+// natural alignment of a class: its lowest set bit (blocks sit back to back from an offset
+// aligned to it)
+constexpr std::size_t class_align(std::size_t size) noexcept { return size & (~size + 1); }
+
+// the page pool carves pages from reservations of arena_bytes, aligned to huge_page_size
+inline constexpr std::size_t arena_bytes = std::size_t{1} << 30; //1GB
+inline constexpr std::size_t huge_page_size = 2 * 1024 * 1024; //2MB
+
+// span layout: each page starts with a Span descriptor (span_header_bytes) and one ThreadId
+// per block, then blocks of one class back to back at their natural alignment (class_align)
+inline constexpr std::size_t span_header_bytes = 64;
+
+struct ClassLayout {
+    std::uint32_t first; // offset of block 0 from the page start
+    std::uint32_t count; // blocks per page
+    std::uint32_t recip; // ceil(2^32 / size): (offset * recip) >> 32 == offset / size on a page
+};
+
+constexpr std::uint32_t class_reciprocal(std::size_t size) noexcept {
+    return static_cast<std::uint32_t>(((std::uint64_t{1} << 32) + size - 1) / size);
+}
+
+// large objects: sizes past max_small_size and alignments past max_class_align get a span of
+// their own, the block at max(span_header_bytes, align) from its start. Spans of up to
+// max_span_pages come from the page pool (cached as Config::large_cache_bytes and
+// Config::retain_large_pages allow); larger spans are mapped directly.
+inline constexpr std::size_t max_span_pages = 16; //1MB with 64KB pages
+
+// cache_overflow_decay overflows in a row shrink a thread cache class by a batch
+inline constexpr std::uint8_t cache_overflow_decay = 3;
+
+// Everything derived from a policy: the class table, the size -> class index, page layouts
+// and per-class batch sizes and limits.
+template <class Config>
+struct config_traits {
+    static constexpr std::size_t class_small_step = Config::class_small_step;
+    static constexpr std::size_t class_small_max = Config::class_small_max;
+    static constexpr std::size_t class_steps_per_doubling = Config::class_steps_per_doubling;
+    static constexpr std::size_t max_small_size = Config::max_small_size;
+    static constexpr std::size_t page_size = Config::page_size;
+    static constexpr std::size_t total_thread_cache_bytes = Config::total_thread_cache_bytes;
+    static constexpr std::size_t min_thread_cache_bytes = Config::min_thread_cache_bytes;
+    static constexpr std::size_t max_thread_cache_bytes = Config::max_thread_cache_bytes;
+    static constexpr std::size_t retain_empty_pages = Config::retain_empty_pages;
+    static constexpr std::size_t map_cache_bytes = Config::map_cache_bytes;
+
+    template <class Emit>
+    static constexpr void for_each_class_size(Emit&& emit) {
+        std::size_t size = class_small_step;
+        for (; size <= class_small_max; size += class_small_step) { emit(size); }
+        for (std::size_t base = class_small_max; base < max_small_size; base *= 2) {
+            for (std::size_t step = 1; step <= class_steps_per_doubling; ++step) {
+                emit(base + step * (base / class_steps_per_doubling));
+            }
+        }
+    }
+
+    static constexpr std::size_t NumClasses = [] {
+        std::size_t n = 0;
+        for_each_class_size([&](std::size_t) { ++n; });
+        return n;
+    }();
+
+    static constexpr std::array<SizeClassId, NumClasses> sizes = [] {
+        std::array<SizeClassId, NumClasses> out{};
+        std::size_t n = 0;
+        for_each_class_size([&](std::size_t size) { out[n++] = static_cast<SizeClassId>(size); });
+        return out;
+    }();
+    static_assert(std::ranges::is_sorted(sizes) && sizes.back() == max_small_size, "classes must ascend to max_small_size");
+    static_assert(std::ranges::all_of(sizes, [](SizeClassId s) { return s % class_small_step == 0; }),
+        "class lookup is indexed in class_small_step granules");
+    static_assert(NumClasses < std::numeric_limits<std::uint8_t>::max(), "class_index stores classes as bytes");
+    static_assert(std::has_single_bit(class_small_step) && std::has_single_bit(page_size));
+
+    // size -> class in one load: class_index[align_row(align)][granules(size)]. Row r only holds
+    // classes aligned to class_small_step << r, for every power of two up to max_class_align;
+    // the last row (larger alignments) and sizes past max_small_size map to NumClasses.
+    static constexpr std::size_t max_class_align = max_small_size;
+    static constexpr std::size_t align_rows = std::countr_zero(max_class_align / class_small_step) + 1;
+    static constexpr std::size_t class_granules = max_small_size / class_small_step + 2;
+
+    // alignment -> row, rounding up to a power of two; alignments up to class_small_step share row 0
+    static constexpr std::size_t align_row(std::size_t align) noexcept {
+        const std::size_t row = static_cast<std::size_t>(std::bit_width((std::max(align, class_small_step) - 1) / class_small_step));
+        return std::min(row, align_rows);
+    }
+
+    static constexpr std::array<std::array<std::uint8_t, class_granules>, align_rows + 1> class_index = [] {
+        std::array<std::array<std::uint8_t, class_granules>, align_rows + 1> index{};
+        for (std::size_t row = 0; row <= align_rows; ++row) {
+            const std::size_t align = class_small_step << row;
+            for (std::size_t g = 0; g < class_granules; ++g) {
+                std::size_t c = 0;
+                while (c < NumClasses && (sizes[c] < g * class_small_step || class_align(sizes[c]) < align)) { ++c; }
+                index[row][g] = static_cast<std::uint8_t>(c);
+            }
+        }
+        return index;
+    }();
+
+    // every class a row can return is aligned for that row, so a cached block of the chosen
+    // class never needs an alignment recheck after it has been freed and reused
+    static_assert([] {
+        for (std::size_t row = 0; row <= align_rows; ++row) {
+            for (std::uint8_t c : class_index[row]) {
+                if (c < NumClasses && class_align(sizes[c]) < (class_small_step << row)) { return false; }
+            }
+        }
+        return true;
+    }(), "class_index rows must only hold classes aligned for the row");
+
+    // One load from class_index; sizes past max_small_size and alignments past
+    // max_class_align yield NumClasses. Large sizes saturate before rounding up, so the
+    // last few below SIZE_MAX cannot wrap around to granule 0.
+    [[gnu::always_inline]] static inline constexpr SizeClassId get_bucket(std::size_t size, std::size_t align) noexcept {
+        const std::size_t granule = size > max_small_size ? class_granules - 1 : (size + class_small_step - 1) / class_small_step;
+        return class_index[align_row(align)][granule];
+    }
+
+    static_assert(get_bucket(std::numeric_limits<std::size_t>::max(), 1) == NumClasses);
+
+    static_assert(page_size <= (std::size_t{1} << 32) / max_small_size, "reciprocal division must be exact on a page");
+    static_assert(page_size >= 4 * max_small_size && huge_page_size % page_size == 0,
+        "pages hold several of the largest blocks and tile the arena");
+
+    static constexpr std::array<ClassLayout, NumClasses> class_layout = [] {
+        std::array<ClassLayout, NumClasses> layout{};
+        for (std::size_t i = 0; i < NumClasses; ++i) {
+            const std::size_t size = sizes[i];
+            std::size_t count = (page_size - span_header_bytes) / (size + sizeof(ThreadId));
+            const std::size_t align = class_align(size);
+            std::size_t first = 0;
+            for (;; --count) {
+                first = span_header_bytes + count * sizeof(ThreadId);
+                first = (first + align - 1) & ~(align - 1);
+                if (first + count * size <= page_size) { break; }
+            }
+            layout[i] = ClassLayout{static_cast<std::uint32_t>(first), static_cast<std::uint32_t>(count),
+                                    class_reciprocal(size)};
+        }
+        return layout;
+    }();
+
+    static constexpr SizeClassId large_class = NumClasses; // Span::size_class of a large span
+
+    // per-class batch (Config::refill_batch), the refill it adapts from and the thread cache
+    // limit it scales
+    static constexpr std::array<std::uint32_t, NumClasses> batch = [] {
+        std::array<std::uint32_t, NumClasses> out{};
+        for (std::size_t i = 0; i < NumClasses; ++i) { out[i] = Config::refill_batch(sizes[i]); }
+        return out;
+    }();
+    static_assert(std::ranges::all_of(batch, [](std::uint32_t b) { return b > 0; }), "a batch moves at least one block");
+
+    // first (and smallest) refill of a thread
+    static constexpr std::array<std::uint32_t, NumClasses> refill_floor = [] {
+        std::array<std::uint32_t, NumClasses> out{};
+        for (std::size_t i = 0; i < NumClasses; ++i) {
+            out[i] = Config::adaptive_refill ? std::max<std::uint32_t>(batch[i] / Config::refill_start_div, 1) : batch[i];
+        }
+        return out;
+    }();
+
+    static constexpr std::array<std::uint32_t, NumClasses> cache_max_length = [] {
+        std::array<std::uint32_t, NumClasses> out{};
+        for (std::size_t i = 0; i < NumClasses; ++i) { out[i] = Config::cache_max_batches * batch[i]; }
+        return out;
+    }();
+
+    static constexpr std::array<std::uint32_t, NumClasses> transfer_capacity = [] {
+        std::array<std::uint32_t, NumClasses> cap{};
+        for (std::size_t i = 0; i < NumClasses; ++i) {
+            const std::size_t batches = Config::transfer_cache_bytes / (std::size_t{sizes[i]} * batch[i]);
+            cap[i] = static_cast<std::uint32_t>(std::clamp<std::size_t>(batches, 2, Config::transfer_slots));
+        }
+        return cap;
+    }();
+};
+
+// The default policy's tables under their plain names.
+using default_traits = config_traits<default_config>;
+inline constexpr std::size_t class_small_step = default_traits::class_small_step;
+inline constexpr std::size_t max_small_size = default_traits::max_small_size;
+inline constexpr std::size_t NumClasses = default_traits::NumClasses;
+inline constexpr const auto& sizes = default_traits::sizes;
+inline constexpr std::size_t max_class_align = default_traits::max_class_align;
+inline constexpr std::size_t align_rows = default_traits::align_rows;
+inline constexpr const auto& class_layout = default_traits::class_layout;
+inline constexpr SizeClassId large_class = default_traits::large_class;
+inline constexpr std::size_t page_size = default_traits::page_size;
+inline constexpr std::size_t retain_empty_pages = default_traits::retain_empty_pages;
+
+static_assert(default_traits::align_row(1) == 0 && default_traits::align_row(16) == 0
+    && default_traits::align_row(17) == 1 && default_traits::align_row(64) == 2
+    && default_traits::align_row(max_class_align) == align_rows - 1
+    && default_traits::align_row(max_class_align + 1) == align_rows);
+
+// registry: ThreadId -> ThreadCache* table, allocated one chunk at a time
+inline constexpr std::size_t registry_chunk_size = 256;
+inline constexpr std::size_t registry_chunks = 256;
+static_assert(registry_chunk_size * registry_chunks == std::size_t{std::numeric_limits<ThreadId>::max()} + 1,
+    "registry must cover every ThreadId");
@@ -0,0 +1,370 @@
+#pragma once
+#include "config.h"
+#include <atomic>
+#include <memory>
+#include <sched.h>
+#if defined(__x86_64__) && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#include <cstddef>
+#define SLAB_HAVE_RSEQ 1
+#endif
+
+// True when libc registered a restartable-sequence area for every thread (glibc 2.35+ on
+// x86-64 does unless disabled by tunable), so CpuCaches can run without locks.
+bool rseq_available() noexcept;
+// Lists CpuCaches keeps: one per CPU the kernel may report.
+std::size_t cpu_slots() noexcept;
+
+#ifdef SLAB_HAVE_RSEQ
+// Restartable sequences on one CPU's list head. Each op checks that the thread is still on
+// cpu, reads the head and ends in a single committing store; if the thread is preempted,
+// migrated or signalled in between, the kernel moves it to the abort label and the op
+// reports -1 for the caller to retry with a fresh cpu. Returns 0 when it committed and 1
+// when it stopped without a store (empty or full list, occupied slot).
+namespace Rseq {
+
+    // Nodes of a per-CPU list: depth counts the blocks from this one to the end of the list,
+    // so the head alone tells the list length.
+    struct Node {
+        Node* next;
+        std::uintptr_t depth;
+    };
+
+    static_assert(offsetof(struct rseq, cpu_id) == 4 && offsetof(struct rseq, rseq_cs) == 8);
+    static_assert(offsetof(Node, next) == 0 && offsetof(Node, depth) == 8);
+
+    #define SLAB_RSEQ_STR_(x) #x
+    #define SLAB_RSEQ_STR(x) SLAB_RSEQ_STR_(x)
+    // Descriptor of the section [1, 2) aborting to 4, armed through the thread's rseq_cs
+    // before the cpu check; the abort stub is signed with RSEQ_SIG as the kernel requires.
+    #define SLAB_RSEQ_BEGIN                                     \
+        ".pushsection __rseq_cs, \"aw\"\n\t"                    \
+        ".balign 32\n\t"                                        \
+        "3:\n\t"                                                \
+        ".long 0, 0\n\t"                                        \
+        ".quad 1f, (2f - 1f), 4f\n\t"                           \
+        ".popsection\n\t"                                       \
+        "leaq 3b(%%rip), %%rax\n\t"                             \
+        "movq %%rax, %%fs:8(%[rseq])\n\t"                       \
+        "1:\n\t"                                                \
+        "cmpl %[cpu], %%fs:4(%[rseq])\n\t"                      \
+        "jnz 4f\n\t"
+    #define SLAB_RSEQ_END                                       \
+        "2:\n\t"                                                \
+        ".pushsection __rseq_failure, \"ax\"\n\t"               \
+        ".byte 0x0f, 0xb9, 0x3d\n\t"                            \
+        ".long " SLAB_RSEQ_STR(RSEQ_SIG) "\n\t"                 \
+        "4:\n\t"                                                \
+        "jmp %l[aborted]\n\t"                                   \
+        ".popsection\n\t"
+
+    // The cpu the kernel last recorded for this thread; negative if rseq is not registered.
+    [[gnu::always_inline]] inline int current_cpu() noexcept {
+        const auto* area = reinterpret_cast<const struct rseq*>(
+            static_cast<const char*>(__builtin_thread_pointer()) + __rseq_offset);
+        return static_cast<int>(__atomic_load_n(&area->cpu_id, __ATOMIC_RELAXED));
+    }
+
+    // head = head->next, the old head to out; 1 if the list is empty.
+    [[gnu::always_inline]] inline int pop(Node** head, Node** out, int cpu) noexcept {
+        asm goto(
+            SLAB_RSEQ_BEGIN
+            "movq %[head], %%rbx\n\t"
+            "testq %%rbx, %%rbx\n\t"
+            "jz %l[empty]\n\t"
+            "movq %%rbx, %[out]\n\t"
+            "movq (%%rbx), %%rbx\n\t"
+            "movq %%rbx, %[head]\n\t"
+            SLAB_RSEQ_END
+            :
+            : [cpu] "r"(cpu), [rseq] "r"(__rseq_offset), [head] "m"(*head), [out] "m"(*out)
+            : "memory", "cc", "rax", "rbx"
+            : aborted, empty);
+        return 0;
+    aborted:
+        return -1;
+    empty:
+        return 1;
+    }
+
+    // Links node in front of head with its depth; 1 if head already holds limit blocks.
+    [[gnu::always_inline]] inline int push(Node** head, Node* node, std::uintptr_t limit, int cpu) noexcept {
+        asm goto(
+            SLAB_RSEQ_BEGIN
+            "movq %[head], %%rbx\n\t"
+            "xorl %%ecx, %%ecx\n\t"
+            "testq %%rbx, %%rbx\n\t"
+            "jz 5f\n\t"
+            "movq 8(%%rbx), %%rcx\n\t"
+            "cmpq %[limit], %%rcx\n\t"
+            "jae %l[full]\n\t"
+            "5:\n\t"
+            "addq $1, %%rcx\n\t"
+            "movq %%rbx, (%[node])\n\t"
+            "movq %%rcx, 8(%[node])\n\t"
+            "movq %[node], %[head]\n\t"
+            SLAB_RSEQ_END
+            :
+            : [cpu] "r"(cpu), [rseq] "r"(__rseq_offset), [head] "m"(*head), [node] "r"(node), [limit] "r"(limit)
+            : "memory", "cc", "rax", "rbx", "rcx"
+            : aborted, full);
+        return 0;
+    aborted:
+        return -1;
+    full:
+        return 1;
+    }
+
+    // head = chain if head is empty; 1 if it is not.
+    inline int install(Node** head, Node* chain, int cpu) noexcept {
+        asm goto(
+            SLAB_RSEQ_BEGIN
+            "cmpq $0, %[head]\n\t"
+            "jnz %l[occupied]\n\t"
+            "movq %[chain], %[head]\n\t"
+            SLAB_RSEQ_END
+            :
+            : [cpu] "r"(cpu), [rseq] "r"(__rseq_offset), [head] "m"(*head), [chain] "r"(chain)
+            : "memory", "cc", "rax"
+            : aborted, occupied);
+        return 0;
+    aborted:
+        return -1;
+    occupied:
+        return 1;
+    }
+
+    // Detaches the whole list to out, leaving head empty.
+    inline int take(Node** head, Node** out, int cpu) noexcept {
+        asm goto(
+            SLAB_RSEQ_BEGIN
+            "movq %[head], %%rbx\n\t"
+            "movq %%rbx, %[out]\n\t"
+            "movq $0, %[head]\n\t"
+            SLAB_RSEQ_END
+            :
+            : [cpu] "r"(cpu), [rseq] "r"(__rseq_offset), [head] "m"(*head), [out] "m"(*out)
+            : "memory", "cc", "rax", "rbx"
+            : aborted);
+        return 0;
+    aborted:
+        return -1;
+    }
+
+    #undef SLAB_RSEQ_BEGIN
+    #undef SLAB_RSEQ_END
+}
+#endif
+
+// Free lists per CPU instead of per thread (Config::per_cpu_caches): a block freed on a CPU
+// is reused by whichever thread runs there next, so cached memory scales with cores, not
+// threads. With rseq every op is a restartable sequence on the current CPU's lists, with no
+// lock or atomic read-modify-write; otherwise sched_getcpu picks the lists and a per-CPU
+// spin flag guards them.
+template <class Config = default_config>
+class CpuCaches {
+    using C = config_traits<Config>;
+
+    public:
+
+    explicit CpuCaches(bool use_rseq = rseq_available()) noexcept;
+    CpuCaches(const CpuCaches&) = delete;
+    CpuCaches& operator=(const CpuCaches&) = delete;
+
+    // A block of the class from the current CPU's list, or nullptr when it is empty.
+    [[gnu::always_inline]] inline void* pop(SizeClassId size_class) noexcept;
+    // Caches a block on the current CPU's list; false (block not taken) once the list
+    // holds limit blocks.
+    [[gnu::always_inline]] inline bool push(SizeClassId size_class, void* ptr, std::uint32_t limit) noexcept;
+    // Makes a chain the current CPU's list if that list is empty; false (chain not taken) if it is not.
+    [[gnu::noinline]] bool fill(SizeClassId size_class, FreeNode* chain) noexcept;
+    // Detaches the current CPU's list of the class.
+    [[gnu::noinline]] FreeNode* take_all(SizeClassId size_class) noexcept;
+    // For a full list: detaches it, pushes ptr onto all but its first n blocks and puts that
+    // back, and returns the n blocks (plus the rest if another thread refilled meanwhile).
+    [[gnu::noinline]] FreeNode* push_overflow(SizeClassId size_class, void* ptr, std::uint32_t n) noexcept;
+
+    bool uses_rseq() const noexcept { return rseq; }
+    // Every spin flag (fallback mode), for fork().
+    void lock_all() noexcept;
+    void unlock_all() noexcept;
+
+    private:
+
+#ifdef SLAB_HAVE_RSEQ
+    using Node = Rseq::Node;
+#else
+    struct Node {
+        Node* next;
+        std::uintptr_t depth; // blocks from this one to the end of the list
+    };
+#endif
+    static_assert(sizeof(Node) <= C::class_small_step, "a node fits in the smallest block");
+
+    struct alignas(64) Cpu {
+        std::atomic<bool> busy{false}; // fallback mode only
+        std::array<Node*, C::NumClasses> heads{};
+    };
+
+    // The fallback's cpu, its lists locked.
+    Cpu& lock_current() noexcept;
+    static void unlock(Cpu& cpu) noexcept;
+    // Writes depths along a chain handed in from outside; returns it as a list.
+    static Node* stamp(FreeNode* chain) noexcept;
+
+    const std::size_t count;
+    std::unique_ptr<Cpu[]> cpus;
+    const bool rseq;
+};
+
+template <class Config>
+CpuCaches<Config>::CpuCaches(bool use_rseq) noexcept
+    : count(cpu_slots()), cpus(new Cpu[count]), rseq(use_rseq && rseq_available()) {}
+
+template <class Config>
+[[gnu::always_inline]] inline void* CpuCaches<Config>::pop(SizeClassId size_class) noexcept {
+#ifdef SLAB_HAVE_RSEQ
+    if (rseq) [[likely]] {
+        for (;;) {
+            const int cpu = Rseq::current_cpu();
+            if (static_cast<std::size_t>(cpu) >= count) [[unlikely]] { return nullptr; } // unknown cpu: bypass
+            Node* node = nullptr;
+            const int r = Rseq::pop(&cpus[cpu].heads[size_class], &node, cpu);
+            if (r == 0) { return node; }
+            if (r > 0) { return nullptr; }
+        }
+    }
+#endif
+    Cpu& cpu = lock_current();
+    Node* node = cpu.heads[size_class];
+    if (node) { cpu.heads[size_class] = node->next; }
+    unlock(cpu);
+    return node;
+}
+
+template <class Config>
+[[gnu::always_inline]] inline bool CpuCaches<Config>::push(SizeClassId size_class, void* ptr, std::uint32_t limit) noexcept {
+    Node* node = static_cast<Node*>(ptr);
+#ifdef SLAB_HAVE_RSEQ
+    if (rseq) [[likely]] {
+        for (;;) {
+            const int cpu = Rseq::current_cpu();
+            if (static_cast<std::size_t>(cpu) >= count) [[unlikely]] { return false; }
+            const int r = Rseq::push(&cpus[cpu].heads[size_class], node, limit, cpu);
+            if (r >= 0) { return r == 0; }
+        }
+    }
+#endif
+    Cpu& cpu = lock_current();
+    Node* head = cpu.heads[size_class];
+    const std::uintptr_t depth = head ? head->depth : 0;
+    const bool taken = depth < limit;
+    if (taken) {
+        node->next = head;
+        node->depth = depth + 1;
+        cpu.heads[size_class] = node;
+    }
+    unlock(cpu);
+    return taken;
+}
+
+template <class Config>
+[[gnu::noinline]] bool CpuCaches<Config>::fill(SizeClassId size_class, FreeNode* chain) noexcept {
+    Node* list = stamp(chain);
+#ifdef SLAB_HAVE_RSEQ
+    if (rseq) {
+        for (;;) {
+            const int cpu = Rseq::current_cpu();
+            if (static_cast<std::size_t>(cpu) >= count) { return false; }
+            const int r = Rseq::install(&cpus[cpu].heads[size_class], list, cpu);
+            if (r >= 0) { return r == 0; }
+        }
+    }
+#endif
+    Cpu& cpu = lock_current();
+    const bool taken = cpu.heads[size_class] == nullptr;
+    if (taken) { cpu.heads[size_class] = list; }
+    unlock(cpu);
+    return taken;
+}
+
+template <class Config>
+[[gnu::noinline]] FreeNode* CpuCaches<Config>::take_all(SizeClassId size_class) noexcept {
+    Node* list = nullptr;
+#ifdef SLAB_HAVE_RSEQ
+    if (rseq) {
+        for (;;) {
+            const int cpu = Rseq::current_cpu();
+            if (static_cast<std::size_t>(cpu) >= count) { return nullptr; }
+            if (Rseq::take(&cpus[cpu].heads[size_class], &list, cpu) == 0) { return reinterpret_cast<FreeNode*>(list); }
+        }
+    }
+#endif
+    Cpu& cpu = lock_current();
+    list = cpu.heads[size_class];
+    cpu.heads[size_class] = nullptr;
+    unlock(cpu);
+    return reinterpret_cast<FreeNode*>(list);
+}
+
+template <class Config>
+[[gnu::noinline]] FreeNode* CpuCaches<Config>::push_overflow(SizeClassId size_class, void* ptr, std::uint32_t n) noexcept {
+    Node* batch = reinterpret_cast<Node*>(take_all(size_class));
+    Node* tail = nullptr;
+    Node* rest = batch;
+    for (std::uint32_t i = 0; i < n && rest; ++i) {
+        tail = rest;
+        rest = rest->next;
+    }
+    if (tail) { tail->next = nullptr; } else { batch = nullptr; }
+
+    // the rest keeps its depths (they count from the end), so ptr goes on top as is
+    Node* node = static_cast<Node*>(ptr);
+    node->next = rest;
+    node->depth = (rest ? rest->depth : 0) + 1;
+    if (!fill(size_class, reinterpret_cast<FreeNode*>(node))) {
+        if (tail) { tail->next = node; } else { batch = node; }
+    }
+    return reinterpret_cast<FreeNode*>(batch);
+}
+
+template <class Config>
+typename CpuCaches<Config>::Node* CpuCaches<Config>::stamp(FreeNode* chain) noexcept {
+    std::uintptr_t depth = 0;
+    for (FreeNode* node = chain; node; node = node->next) { ++depth; }
+    for (Node* node = reinterpret_cast<Node*>(chain); node; node = node->next) { node->depth = depth--; }
+    return reinterpret_cast<Node*>(chain);
+}
+
+template <class Config>
+typename CpuCaches<Config>::Cpu& CpuCaches<Config>::lock_current() noexcept {
+    const int id = sched_getcpu();
+    Cpu& cpu = cpus[id < 0 ? 0 : static_cast<std::size_t>(id) % count];
+    while (cpu.busy.exchange(true, std::memory_order_acquire)) {
+        while (cpu.busy.load(std::memory_order_relaxed)) { sched_yield(); }
+    }
+    return cpu;
+}
+
+template <class Config>
+void CpuCaches<Config>::unlock(Cpu& cpu) noexcept {
+    cpu.busy.store(false, std::memory_order_release);
+}
+
+template <class Config>
+void CpuCaches<Config>::lock_all() noexcept {
+    if (rseq) { return; }
+    for (std::size_t i = 0; i < count; ++i) {
+        while (cpus[i].busy.exchange(true, std::memory_order_acquire)) { sched_yield(); }
+    }
+}
+
+template <class Config>
+void CpuCaches<Config>::unlock_all() noexcept {
+    if (rseq) { return; }
+    for (std::size_t i = 0; i < count; ++i) { unlock(cpus[i]); }
+}
+// Stands in for CpuCaches in slabs with per-thread caches.
+struct NoCpuCaches {};
+
+extern template class CpuCaches<per_cpu_config>;
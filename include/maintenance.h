@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <pthread.h>
+#include <sys/types.h>
+
+// Settings of a slab's background maintenance thread (basic_slab::start_maintenance).
+struct MaintenanceOptions {
+    int cpu = -1;                            // CPU to pin the thread to, -1 leaves its affinity alone
+    std::chrono::microseconds period{1000};  // pause between passes
+
+    // top-ups: every class threads looked for a transfer-cache batch of since the last pass
+    // keeps ready_batches batches there, built (and faulted in) ahead of the miss that needs
+    // them; at most max_batches_per_pass are built per pass
+    std::uint32_t ready_batches = 2;
+    std::uint32_t max_batches_per_pass = 16;
+
+    // fully free pages kept mapped and faulted in (up to the page retention limit), so a
+    // refill that needs a fresh page does not take the page faults
+    std::size_t prefault_pages = 8;
+
+    // scavenging: the batches of a class nobody looked for in idle_passes passes go back to
+    // the page pool, and fully free pages past the retention limit go back to the OS, at most
+    // max_release_pages per pass (while the thread runs, frees leave that to it)
+    std::uint32_t idle_passes = 1000;
+    std::size_t max_release_pages = 64;
+};
+
+// Work done by a maintenance thread so far.
+struct MaintenanceStats {
+    std::uint64_t passes;
+    std::uint64_t batches_built;
+    std::uint64_t pages_prefaulted;
+    std::uint64_t batches_scavenged;
+    std::uint64_t pages_released;
+};
+
+// A thread running pass(owner, *this) every options().period until stop(). Not carried
+// over fork(): in a child, stop() only forgets the parent's thread, whose wait state the
+// child's copy still records (so that copy is not safe to destroy).
+class MaintenanceThread {
+    public:
+
+    using Pass = void (*)(void* owner, MaintenanceThread& thread) noexcept;
+
+    explicit MaintenanceThread(const MaintenanceOptions& options) noexcept : options_(options) {}
+    ~MaintenanceThread() noexcept { stop(); }
+    MaintenanceThread(const MaintenanceThread&) = delete;
+    MaintenanceThread& operator=(const MaintenanceThread&) = delete;
+
+    // False if the thread could not be created (or pinned to options().cpu).
+    bool start(Pass pass, void* owner) noexcept;
+    // Waits for the current pass to finish; idempotent. False in a forked child.
+    bool stop() noexcept;
+
+    const MaintenanceOptions& options() const noexcept { return options_; }
+    MaintenanceStats stats() const noexcept;
+
+    // Bumped by the pass.
+    void count(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+    std::atomic<std::uint64_t> passes{0};
+    std::atomic<std::uint64_t> batches_built{0};
+    std::atomic<std::uint64_t> pages_prefaulted{0};
+    std::atomic<std::uint64_t> batches_scavenged{0};
+    std::atomic<std::uint64_t> pages_released{0};
+
+    private:
+
+    static void* run(void* self) noexcept;
+
+    const MaintenanceOptions options_;
+    Pass pass_ = nullptr;
+    void* owner_ = nullptr;
+    std::mutex mu_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    bool running_ = false;
+    pthread_t thread_{};
+    pid_t pid_ = 0; // process that started the thread
+};
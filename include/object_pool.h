@@ -0,0 +1,30 @@
+#pragma once
+#include "slab.h"
+#include <new>
+#include <utility>
+
+// Typed front end over a slab (any basic_slab) for one object type: create/destroy go through the
+// compile-time alloc<sizeof(T), alignof(T)>/free fast paths. Pools are cheap handles;
+// any number can share one slab, which must outlive them.
+template <class T, class Slab = slab>
+class object_pool {
+    Slab* backing;
+
+    public:
+
+    explicit object_pool(Slab& backing) noexcept : backing(&backing) {}
+
+    // Constructs a T in a fresh block; nullptr if memory ran out.
+    template <class... Args>
+    [[nodiscard]] T* create(Args&&... args) {
+        void* ptr = backing->template alloc<sizeof(T), alignof(T)>();
+        if (!ptr) [[unlikely]] { return nullptr; }
+        return ::new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* obj) noexcept {
+        if (!obj) {return;}
+        obj->~T();
+        backing->template free<sizeof(T), alignof(T)>(obj);
+    }
+};
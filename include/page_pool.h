@@ -1,25 +1,662 @@
 #pragma once
 #include "config.h"
+#include "span.h"
 #include <vector>
 #include <array>
+#include <atomic>
 #include <mutex>
 #include <cstdlib>
 #include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
 
+// Where PagePool gets its pages from.
+enum class PageBacking : std::uint8_t {
+    PerPage,   // one mmap per page
+    Arena,     // carved from arena_bytes reservations
+    HugeArena, // Arena, advised to use transparent huge pages when the kernel has them
+};
+
+template <class Config = default_config>
 class PagePool {
-    std::array<std::vector<void*>, NumClasses> pages{};
-    std::mutex mu_;
-    std::array<std::byte*, NumClasses> curr{}; //curr page per class, nullptr means none
-    std::array<std::uint32_t, NumClasses> remaining{}; // remainng pages per class
+    using C = config_traits<Config>;
+
+    // One shard per size class, each on its own cache line, so refills of different
+    // classes never wait on each other.
+    struct alignas(64) Shard {
+        std::mutex mu_;
+        std::byte* curr = nullptr;      // next block to carve, nullptr means none
+        std::uint32_t remaining = 0;    // bytes left in curr
+        Span* curr_span = nullptr;
+        Span* partial = nullptr;        // spans holding returned blocks
+        std::vector<void*> spares;      // mapped while another thread refilled, unused yet
+        std::atomic<std::uint64_t> acquisitions{0}; // written under mu_, read by lock_count
+    };
+
+    std::array<Shard, C::NumClasses> shards;
 
+    // Pages whose blocks all came back, shared by every class. Empty pages stay backed
+    // up to the retention limit; the rest are madvised away and their address range reused.
+    std::mutex free_mu_;
+    std::vector<void*> empty_pages;
+    std::vector<void*> released_pages;
+    std::atomic<std::size_t> retain_pages{C::retain_empty_pages};
+    std::atomic<bool> deferred_release{false}; // release_excess releases pages, not frees
+
+    // Freed large spans by page count, backed ones up to Config::retain_large_pages, then released
+    // ones. Directly mapped spans past max_span_pages are kept in map_cache for reuse.
+    std::mutex large_mu_;
+    std::array<std::vector<Span*>, max_span_pages + 1> large_spans;
+    std::array<std::vector<Span*>, max_span_pages + 1> released_spans;
+    std::size_t large_backed = 0;   // pages held in large_spans
+    std::vector<Span*> map_cache;
+    std::size_t map_cached = 0;     // bytes held in map_cache
+    std::vector<Span*> direct_maps; // every direct mapping, live or cached
+
+    // Reservations are carved by a bump cursor; pages are only unmapped with the pool.
+    // If a reservation fails the pool falls back to one mmap per page for good.
+    const PageBacking backing;
+    std::mutex map_mu_;
+    std::byte* arena_cursor = nullptr;
+    std::byte* arena_end = nullptr;
+    bool arena_failed = false;
+    std::vector<void*> arenas;      // arena_bytes reservations
+    std::vector<std::pair<void*, std::size_t>> page_maps; // fallback mappings and their bytes
+
+    static std::size_t align_up(std::size_t x, std::size_t a) noexcept;
+    static void link_partial(Span*& head, Span* pg) noexcept;
+    static void unlink_partial(Span*& head, Span* pg) noexcept;
+    static void count_lock(Shard& shard) noexcept;
+    bool reserve_arena() noexcept;
+    void* map_aligned(std::size_t bytes) noexcept;
     void* alloc_page(std::size_t bytes) noexcept;
     void free_page(void* ptr, std::size_t bytes) noexcept;
+    void* reuse_page() noexcept;
+    void page_emptied(void* page, std::vector<void*>& victims) noexcept;
+    std::size_t release_pages(std::vector<void*>& victims) noexcept;
+    bool ensure_page(Shard& shard, std::unique_lock<std::mutex>& lk, SizeClassId size_class) noexcept;
+    template <class Emit>
+    std::size_t take_returned(Shard& shard, ThreadId owner, std::size_t n, Emit&& emit) noexcept;
+    std::byte* carve(Shard& shard, std::unique_lock<std::mutex>& lk, SizeClassId size_class,
+        ThreadId owner, std::size_t n, std::size_t& got, std::vector<void*>& victims) noexcept;
+    std::size_t release_spans(std::vector<std::pair<Span*, std::size_t>>& victims) noexcept;
+    Span* map_direct(std::size_t pages) noexcept;
+    void unmap_direct(Span* span) noexcept;
 
     public:
 
+    explicit PagePool(PageBacking backing = PageBacking::HugeArena) noexcept;
     ~PagePool() noexcept;
-    void get_batch(SizeClassId size_class, ThreadId owner, std::size_t batch, 
-        std::vector<void*>& out, std::size_t align) noexcept;
-    
-    
+    // Writes up to batch blocks of one class, owned by owner, to out; returns how many
+    // (fewer only if the OS refused a page).
+    std::size_t get_batch(SizeClassId size_class, ThreadId owner, std::size_t batch, void** out) noexcept;
+    // Up to batch blocks for a thread cache without touching fresh memory: returned blocks
+    // prepended to list, then a range [carve_begin, carve_end) of untouched blocks the
+    // cache carves lazily. Returns the number of blocks handed out (fewer than batch, even
+    // 0, only if the OS refused a page).
+    std::size_t refill(SizeClassId size_class, ThreadId owner, std::size_t batch,
+        FreeNode*& list, std::byte*& carve_begin, std::byte*& carve_end) noexcept;
+    // Takes back a chain of free blocks of one class; get_batch and refill reuse them before carving.
+    void put_list(SizeClassId size_class, FreeNode* list) noexcept;
+    // A span of at least `pages` contiguous pages for one large object, size_class and
+    // pages filled in, and zeroed set when it comes fresh (or released) from the OS;
+    // nullptr if the OS refuses the mapping.
+    Span* get_span(std::size_t pages) noexcept;
+    // Takes back a large span from get_span; it no longer counts as zeroed.
+    void put_span(Span* span) noexcept;
+    // How many fully free pages stay backed before the rest go back to the OS.
+    void set_retention(std::size_t pages) noexcept;
+    // Maps (or takes back from the OS) and faults in fully free pages until up to `pages`,
+    // capped by the retention limit, wait for refills; returns the pages added.
+    std::size_t prefault(std::size_t pages) noexcept;
+    // While set, frees leave fully free pages past the retention limit to release_excess.
+    void defer_release(bool deferred) noexcept;
+    // Returns up to max_pages fully free pages past the retention limit to the OS, oldest
+    // first; returns the pages released.
+    std::size_t release_excess(std::size_t max_pages) noexcept;
+    // Returns every fully free page and cached large span to the OS; returns the bytes released.
+    std::size_t trim() noexcept;
+    // Every pool lock, in the order the pool nests them, for fork().
+    void lock_all() noexcept;
+    void unlock_all() noexcept;
+    // Shard lock acquisitions so far (get_batch, refill and put_list calls), for tuning batches.
+    std::uint64_t lock_count() const noexcept;
 };
+
+template <class Config>
+std::size_t PagePool<Config>::align_up(std::size_t x, std::size_t a) noexcept {
+    if (a <= 1) { return x; }
+    return (x + (a - 1)) & ~(a - 1);
+}
+
+template <class Config>
+void PagePool<Config>::link_partial(Span*& head, Span* pg) noexcept {
+    pg->prev = nullptr;
+    pg->next = head;
+    if (head) { head->prev = pg; }
+    head = pg;
+    pg->in_partial = true;
+}
+
+// Called with shard.mu_ held, so a plain load and store keep the count exact.
+template <class Config>
+void PagePool<Config>::count_lock(Shard& shard) noexcept {
+    shard.acquisitions.store(shard.acquisitions.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+template <class Config>
+void PagePool<Config>::unlink_partial(Span*& head, Span* pg) noexcept {
+    if (pg->prev) { pg->prev->next = pg->next; } else { head = pg->next; }
+    if (pg->next) { pg->next->prev = pg->prev; }
+    pg->prev = pg->next = nullptr;
+    pg->in_partial = false;
+}
+
+template <class Config>
+PagePool<Config>::PagePool(PageBacking backing) noexcept : backing(backing) {}
+
+template <class Config>
+PagePool<Config>::~PagePool() noexcept {
+    for (void* arena : arenas) { free_page(arena, arena_bytes); }
+    for (auto [page, bytes] : page_maps) { free_page(page, bytes); }
+    for (Span* span : direct_maps) { free_page(span, std::size_t{span->pages} * C::page_size); }
+}
+
+// Reserves arena_bytes of address space aligned to huge_page_size. MAP_NORESERVE keeps
+// untouched pages free; MADV_HUGEPAGE lets the kernel back touched ranges with 2MB pages.
+// MAP_HUGETLB is not used: it needs preallocated hugetlbfs pages and rejects the 64KB
+// MADV_DONTNEED the pool uses to release pages.
+template <class Config>
+bool PagePool<Config>::reserve_arena() noexcept {
+    const std::size_t span = arena_bytes + huge_page_size;
+    void* p = ::mmap(nullptr, span, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) { return false; }
+
+    const auto base = reinterpret_cast<std::uintptr_t>(p);
+    const auto aligned = static_cast<std::uintptr_t>(align_up(base, huge_page_size));
+    if (aligned > base) { ::munmap(p, aligned - base); }
+    const std::size_t tail = (base + span) - (aligned + arena_bytes);
+    if (tail > 0) { ::munmap(reinterpret_cast<void*>(aligned + arena_bytes), tail); }
+
+    auto* arena = reinterpret_cast<std::byte*>(aligned);
+#ifdef MADV_HUGEPAGE
+    if (backing == PageBacking::HugeArena) { ::madvise(arena, arena_bytes, MADV_HUGEPAGE); }
+#endif
+    arenas.push_back(arena);
+    arena_cursor = arena;
+    arena_end = arena + arena_bytes;
+    return true;
+}
+
+// A private mapping of bytes aligned to page_size, trimmed from a page_size-larger one.
+template <class Config>
+void* PagePool<Config>::map_aligned(std::size_t bytes) noexcept {
+    const std::size_t span = bytes + C::page_size;
+    void* p = ::mmap(nullptr, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) { return nullptr; }
+
+    const auto base = reinterpret_cast<std::uintptr_t>(p);
+    const auto aligned = static_cast<std::uintptr_t>(align_up(base, C::page_size));
+    if (aligned > base) { ::munmap(p, aligned - base); }
+    const std::size_t tail = (base + span) - (aligned + bytes);
+    if (tail > 0) { ::munmap(reinterpret_cast<void*>(aligned + bytes), tail); }
+    return reinterpret_cast<void*>(aligned);
+}
+
+// Hands out bytes aligned to page_size, so span_of() can find the span by masking.
+template <class Config>
+[[gnu::noinline]] void* PagePool<Config>::alloc_page(std::size_t bytes) noexcept {
+    std::lock_guard<std::mutex> lk(map_mu_);
+
+    if (backing != PageBacking::PerPage && !arena_failed) {
+        if (arena_cursor + bytes > arena_end && !reserve_arena()) { arena_failed = true; }
+        if (!arena_failed) {
+            void* page = arena_cursor;
+            arena_cursor += bytes;
+            return page;
+        }
+    }
+
+    void* page = map_aligned(bytes);
+    if (page) { page_maps.emplace_back(page, bytes); }
+    return page;
+}
+
+template <class Config>
+[[gnu::noinline]] void PagePool<Config>::free_page(void* ptr, std::size_t bytes) noexcept {
+    ::munmap(ptr, bytes);
+}
+
+// A fully free page from any class: still-backed ones first.
+template <class Config>
+void* PagePool<Config>::reuse_page() noexcept {
+    std::lock_guard<std::mutex> lk(free_mu_);
+    std::vector<void*>& from = !empty_pages.empty() ? empty_pages : released_pages;
+    if (from.empty()) { return nullptr; }
+    void* page = from.back();
+    from.pop_back();
+    return page;
+}
+
+// Parks a page whose last block came back. Pages beyond the retention limit (oldest first)
+// are moved to victims for the caller to release once it holds no shard lock.
+template <class Config>
+void PagePool<Config>::page_emptied(void* page, std::vector<void*>& victims) noexcept {
+    std::lock_guard<std::mutex> lk(free_mu_);
+    empty_pages.push_back(page);
+    const std::size_t keep = retain_pages.load(std::memory_order_relaxed);
+    if (empty_pages.size() <= keep || deferred_release.load(std::memory_order_relaxed)) { return; }
+    const std::size_t excess = empty_pages.size() - keep;
+    victims.insert(victims.end(), empty_pages.begin(), empty_pages.begin() + excess);
+    empty_pages.erase(empty_pages.begin(), empty_pages.begin() + excess);
+}
+
+template <class Config>
+std::size_t PagePool<Config>::release_pages(std::vector<void*>& victims) noexcept {
+    if (victims.empty()) { return 0; }
+    for (void* page : victims) { ::madvise(page, C::page_size, MADV_DONTNEED); }
+    std::lock_guard<std::mutex> lk(free_mu_);
+    released_pages.insert(released_pages.end(), victims.begin(), victims.end());
+    const std::size_t bytes = victims.size() * C::page_size;
+    victims.clear();
+    return bytes;
+}
+
+// Installs a fresh page as the shard's carve target, unless another thread installed one
+// while this one was mapping. False if the OS refused the page.
+template <class Config>
+bool PagePool<Config>::ensure_page(Shard& shard, std::unique_lock<std::mutex>& lk, SizeClassId size_class) noexcept {
+    if (shard.curr != nullptr && shard.remaining > 0) {
+        return true;
+    }
+
+    void* page = nullptr;
+    if (!shard.spares.empty()) {
+        page = shard.spares.back();
+        shard.spares.pop_back();
+    } else if ((page = reuse_page()) == nullptr) {
+        lk.unlock(); // mmap outside the shard lock
+        page = alloc_page(C::page_size);
+        lk.lock();
+
+        // another thread installed a page while we were mapping, keep ours for later
+        if (shard.curr != nullptr && shard.remaining > 0) {
+            if (page) { shard.spares.push_back(page); }
+            return true;
+        }
+        if (page == nullptr) { return false; }
+    }
+
+    const ClassLayout& layout = C::class_layout[size_class];
+    Span* span = ::new (page) Span{};
+    span->first = layout.first;
+    span->size_class = size_class;
+    span->recip = layout.recip;
+    shard.curr_span = span;
+    shard.curr = static_cast<std::byte*>(page) + layout.first;
+    shard.remaining = static_cast<std::uint32_t>(std::size_t{layout.count} * C::sizes[size_class]);
+    return true;
+}
+
+// Hands out up to n returned blocks of the shard's partial spans to emit, owned by owner.
+template <class Config>
+template <class Emit>
+std::size_t PagePool<Config>::take_returned(Shard& shard, ThreadId owner, std::size_t n, Emit&& emit) noexcept {
+    std::size_t made = 0;
+    while (shard.partial && made < n) {
+        Span* span = shard.partial;
+        while (span->free && made < n) {
+            FreeNode* node = span->free;
+            span->free = node->next;
+            span->owners()[span->index_of(node)] = owner;
+            emit(node);
+            ++span->live;
+            ++made;
+        }
+        if (!span->free) { unlink_partial(shard.partial, span); }
+    }
+    return made;
+}
+
+// Claims up to n uncarved blocks of the current page for owner, moving to a new page when
+// it is used up. Only the owner table is written; the blocks themselves are not touched.
+// got is 0 (and the result nullptr) if the OS refused a new page.
+template <class Config>
+std::byte* PagePool<Config>::carve(Shard& shard, std::unique_lock<std::mutex>& lk, SizeClassId size_class,
+        ThreadId owner, std::size_t n, std::size_t& got, std::vector<void*>& victims) noexcept {
+    const std::size_t payload = C::sizes[size_class];
+    if (shard.curr_span && shard.remaining < payload) { // page used up
+        Span* done = shard.curr_span;
+        if (done->live == 0) { // every block came back while we carved it
+            if (done->in_partial) { unlink_partial(shard.partial, done); }
+            page_emptied(done, victims);
+        }
+        shard.curr_span = nullptr;
+        shard.curr = nullptr;
+        shard.remaining = 0;
+    }
+    if (!ensure_page(shard, lk, size_class)) {
+        got = 0;
+        return nullptr;
+    }
+
+    // blocks sit back to back, the owners go in the span's table
+    Span* span = shard.curr_span;
+    got = std::min<std::size_t>(n, shard.remaining / payload);
+    std::fill_n(span->owners() + span->index_of(shard.curr), got, owner);
+    span->live += static_cast<std::uint32_t>(got);
+
+    std::byte* begin = shard.curr;
+    shard.curr += got * payload;
+    shard.remaining = static_cast<std::uint32_t>(shard.remaining - got * payload);
+    return begin;
+}
+
+template <class Config>
+[[gnu::noinline]] std::size_t PagePool<Config>::get_batch(SizeClassId size_class, ThreadId owner,
+        std::size_t batch, void** out) noexcept {
+    const std::size_t payload = C::sizes[size_class];
+    Shard& shard = shards[size_class];
+    std::vector<void*> victims;
+    std::unique_lock<std::mutex> lk(shard.mu_);
+    count_lock(shard);
+
+    // returned blocks first
+    std::size_t made = take_returned(shard, owner, batch, [&](FreeNode* node) noexcept { *out++ = node; });
+
+    while (made < batch) {
+        std::size_t got = 0;
+        std::byte* block = carve(shard, lk, size_class, owner, batch - made, got, victims);
+        if (got == 0) { break; } // out of memory
+        for (std::size_t i = 0; i < got; ++i, block += payload) { *out++ = block; }
+        made += got;
+    }
+
+    lk.unlock();
+    release_pages(victims);
+    return made;
+}
+
+template <class Config>
+[[gnu::noinline]] std::size_t PagePool<Config>::refill(SizeClassId size_class, ThreadId owner, std::size_t batch,
+        FreeNode*& list, std::byte*& carve_begin, std::byte*& carve_end) noexcept {
+    Shard& shard = shards[size_class];
+    std::vector<void*> victims;
+    std::unique_lock<std::mutex> lk(shard.mu_);
+    count_lock(shard);
+
+    // returned blocks as a chain, then (if short) a range of the current page
+    std::size_t made = take_returned(shard, owner, batch, [&](FreeNode* node) noexcept {
+        node->next = list;
+        list = node;
+    });
+    if (made < batch) {
+        std::size_t got = 0;
+        carve_begin = carve(shard, lk, size_class, owner, batch - made, got, victims);
+        carve_end = carve_begin + got * C::sizes[size_class];
+        made += got;
+    }
+
+    lk.unlock();
+    release_pages(victims);
+    return made;
+}
+
+template <class Config>
+void PagePool<Config>::put_list(SizeClassId size_class, FreeNode* list) noexcept {
+    if (!list) { return; }
+    Shard& shard = shards[size_class];
+    std::vector<void*> victims;
+    {
+        std::lock_guard<std::mutex> lk(shard.mu_);
+        count_lock(shard);
+        while (list) {
+            FreeNode* next = list->next;
+            Span* pg = span_of<C::page_size>(list);
+            list->next = pg->free;
+            pg->free = list;
+
+            if (--pg->live == 0 && pg != shard.curr_span) { // every block is back
+                if (pg->in_partial) { unlink_partial(shard.partial, pg); }
+                page_emptied(pg, victims);
+            } else if (!pg->in_partial) {
+                link_partial(shard.partial, pg);
+            }
+            list = next;
+        }
+    }
+    release_pages(victims);
+}
+
+template <class Config>
+void PagePool<Config>::set_retention(std::size_t pages) noexcept {
+    retain_pages.store(pages, std::memory_order_relaxed);
+}
+
+template <class Config>
+std::size_t PagePool<Config>::prefault(std::size_t pages) noexcept {
+    constexpr std::size_t os_page = 4096;
+    std::size_t added = 0;
+    while (added < pages) {
+        void* page = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(free_mu_);
+            if (empty_pages.size() >= std::min(pages, retain_pages.load(std::memory_order_relaxed))) { break; }
+            if (!released_pages.empty()) {
+                page = released_pages.back();
+                released_pages.pop_back();
+            }
+        }
+        if (!page && (page = alloc_page(C::page_size)) == nullptr) { break; }
+        for (std::size_t at = 0; at < C::page_size; at += os_page) {
+            static_cast<volatile std::byte*>(page)[at] = std::byte{0};
+        }
+        std::lock_guard<std::mutex> lk(free_mu_);
+        empty_pages.push_back(page);
+        ++added;
+    }
+    return added;
+}
+
+template <class Config>
+void PagePool<Config>::defer_release(bool deferred) noexcept {
+    deferred_release.store(deferred, std::memory_order_relaxed);
+}
+
+template <class Config>
+std::size_t PagePool<Config>::release_excess(std::size_t max_pages) noexcept {
+    std::vector<void*> victims;
+    {
+        std::lock_guard<std::mutex> lk(free_mu_);
+        const std::size_t keep = retain_pages.load(std::memory_order_relaxed);
+        if (empty_pages.size() <= keep) { return 0; }
+        const std::size_t n = std::min(empty_pages.size() - keep, max_pages);
+        victims.assign(empty_pages.begin(), empty_pages.begin() + n);
+        empty_pages.erase(empty_pages.begin(), empty_pages.begin() + n);
+    }
+    return release_pages(victims) / C::page_size;
+}
+
+template <class Config>
+std::size_t PagePool<Config>::trim() noexcept {
+    std::vector<void*> victims;
+    {
+        std::lock_guard<std::mutex> lk(free_mu_);
+        victims.swap(empty_pages);
+    }
+    std::vector<std::pair<Span*, std::size_t>> spans;
+    std::vector<Span*> maps;
+    {
+        std::lock_guard<std::mutex> lk(large_mu_);
+        for (std::size_t n = 1; n <= max_span_pages; ++n) {
+            for (Span* span : large_spans[n]) { spans.emplace_back(span, n); }
+            large_spans[n].clear();
+        }
+        large_backed = 0;
+        maps.swap(map_cache);
+        map_cached = 0;
+        for (Span* span : maps) { std::erase(direct_maps, span); }
+    }
+
+    std::size_t bytes = release_pages(victims) + release_spans(spans);
+    for (Span* span : maps) {
+        const std::size_t map_bytes = std::size_t{span->pages} * C::page_size;
+        free_page(span, map_bytes);
+        bytes += map_bytes;
+    }
+    return bytes;
+}
+
+// Large spans: reused by exact page count, backed ones first.
+template <class Config>
+Span* PagePool<Config>::get_span(std::size_t pages) noexcept {
+    if (pages > max_span_pages) { return map_direct(pages); }
+
+    void* page = nullptr;
+    bool zeroed = true; // released spans were madvised away, arena and mapped pages are fresh
+    {
+        std::lock_guard<std::mutex> lk(large_mu_);
+        if (!large_spans[pages].empty()) {
+            page = large_spans[pages].back();
+            large_spans[pages].pop_back();
+            large_backed -= pages;
+            zeroed = false;
+        } else if (!released_spans[pages].empty()) {
+            page = released_spans[pages].back();
+            released_spans[pages].pop_back();
+        }
+    }
+    if (!page && (page = alloc_page(pages * C::page_size)) == nullptr) { return nullptr; }
+
+    Span* span = ::new (page) Span{};
+    span->size_class = C::large_class;
+    span->pages = static_cast<std::uint32_t>(pages);
+    span->zeroed = zeroed;
+    return span;
+}
+
+// Spans past the retention limit are released, largest first, oldest first.
+template <class Config>
+void PagePool<Config>::put_span(Span* span) noexcept {
+    span->zeroed = false;
+    const std::size_t pages = span->pages;
+    if (pages > max_span_pages) { unmap_direct(span); return; }
+
+    std::vector<std::pair<Span*, std::size_t>> victims;
+    {
+        std::lock_guard<std::mutex> lk(large_mu_);
+        large_spans[pages].push_back(span);
+        large_backed += pages;
+        for (std::size_t n = max_span_pages; n > 0 && large_backed > Config::retain_large_pages; --n) {
+            std::vector<Span*>& list = large_spans[n];
+            while (!list.empty() && large_backed > Config::retain_large_pages) {
+                victims.emplace_back(list.front(), n);
+                list.erase(list.begin());
+                large_backed -= n;
+            }
+        }
+    }
+    release_spans(victims);
+}
+
+template <class Config>
+std::size_t PagePool<Config>::release_spans(std::vector<std::pair<Span*, std::size_t>>& victims) noexcept {
+    if (victims.empty()) { return 0; }
+    std::size_t bytes = 0;
+    for (auto [span, pages] : victims) {
+        ::madvise(span, pages * C::page_size, MADV_DONTNEED);
+        bytes += pages * C::page_size;
+    }
+    std::lock_guard<std::mutex> lk(large_mu_);
+    for (auto [span, pages] : victims) { released_spans[pages].push_back(span); }
+    victims.clear();
+    return bytes;
+}
+
+// Past max_span_pages: a mapping of its own, or a cached one at most a quarter (and at
+// most max_span_pages) larger.
+template <class Config>
+Span* PagePool<Config>::map_direct(std::size_t pages) noexcept {
+    {
+        std::lock_guard<std::mutex> lk(large_mu_);
+        const std::size_t slack = std::min(pages / 4, max_span_pages);
+        auto best = map_cache.end();
+        for (auto it = map_cache.begin(); it != map_cache.end(); ++it) {
+            const std::size_t have = (*it)->pages;
+            if (have < pages || have > pages + slack) { continue; }
+            if (best == map_cache.end() || have < (*best)->pages) { best = it; }
+        }
+        if (best != map_cache.end()) {
+            Span* span = *best;
+            map_cache.erase(best);
+            map_cached -= std::size_t{span->pages} * C::page_size;
+            return span;
+        }
+    }
+
+    void* page = map_aligned(pages * C::page_size);
+    if (!page) { return nullptr; }
+    Span* span = ::new (page) Span{};
+    span->size_class = C::large_class;
+    span->pages = static_cast<std::uint32_t>(pages);
+    span->zeroed = true;
+
+    std::lock_guard<std::mutex> lk(large_mu_);
+    direct_maps.push_back(span);
+    return span;
+}
+
+// Keeps the mapping for reuse, unmapping the oldest cached ones past Config::large_map_cache
+// mappings or Config::map_cache_bytes; a mapping larger than that is unmapped at once.
+template <class Config>
+void PagePool<Config>::unmap_direct(Span* span) noexcept {
+    std::vector<Span*> evicted;
+    {
+        std::lock_guard<std::mutex> lk(large_mu_);
+        const std::size_t bytes = std::size_t{span->pages} * C::page_size;
+        if (bytes > C::map_cache_bytes) {
+            std::erase(direct_maps, span);
+            evicted.push_back(span);
+        } else {
+            map_cache.push_back(span);
+            map_cached += bytes;
+        }
+        while (map_cache.size() > Config::large_map_cache || map_cached > C::map_cache_bytes) {
+            Span* oldest = map_cache.front();
+            map_cache.erase(map_cache.begin());
+            map_cached -= std::size_t{oldest->pages} * C::page_size;
+            std::erase(direct_maps, oldest);
+            evicted.push_back(oldest);
+        }
+    }
+    for (Span* old : evicted) { free_page(old, std::size_t{old->pages} * C::page_size); }
+}
+
+template <class Config>
+void PagePool<Config>::lock_all() noexcept {
+    for (Shard& shard : shards) { shard.mu_.lock(); }
+    large_mu_.lock();
+    free_mu_.lock();
+    map_mu_.lock();
+}
+
+template <class Config>
+void PagePool<Config>::unlock_all() noexcept {
+    map_mu_.unlock();
+    free_mu_.unlock();
+    large_mu_.unlock();
+    for (Shard& shard : shards) { shard.mu_.unlock(); }
+}
+
+template <class Config>
+std::uint64_t PagePool<Config>::lock_count() const noexcept {
+    std::uint64_t total = 0;
+    for (const Shard& shard : shards) { total += shard.acquisitions.load(std::memory_order_relaxed); }
+    return total;
+}
+
+extern template class PagePool<default_config>;
@@ -1,5 +1,6 @@
 #pragma once
 #include "config.h"
+#include <atomic>
 
 namespace RemoteFree {
 
@@ -12,8 +13,18 @@ namespace RemoteFree {
         }
     }
 
+    // Splices a prebuilt first..last chain onto head with a single successful CAS.
+    template <class NodeType>
+    inline void push_chain_MPSC(std::atomic<NodeType*>& head, NodeType* first, NodeType* last) noexcept {
+        NodeType* old = head.load(std::memory_order_relaxed);
+        last->next = old;
+        while (!head.compare_exchange_weak(old, first, std::memory_order_release, std::memory_order_relaxed)) {
+            last->next = old;
+        }
+    }
+
     template <class NodeType>
     inline NodeType* steal_all(std::atomic<NodeType*>& head) noexcept {
         return head.exchange(nullptr, std::memory_order_acquire);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+// A bounded single-producer single-consumer ring of freed blocks, from one freeing thread
+// cache back to the cache that owns them. A push is a slot store and a release store of
+// the tail, with no CAS and no write into the block; the owner takes published blocks in
+// bulk. Producer and consumer indices sit on cache lines of their own, each side
+// keeping a private copy of the other's index so the shared line is only read on wrap.
+template <std::uint32_t Slots>
+class ReturnRing {
+    static_assert(std::has_single_bit(Slots), "slots are indexed by mask");
+
+    public:
+
+    explicit ReturnRing(const void* producer) noexcept : producer_(producer) {}
+
+    // The cache that pushes into this ring, fixed for the ring's life.
+    const void* producer() const noexcept { return producer_; }
+
+    // Producer side; false (and nothing stored) when the ring is full.
+    [[gnu::always_inline]] inline bool push(void* block) noexcept {
+        const std::uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head_seen == Slots) {
+            head_seen = head.load(std::memory_order_acquire);
+            if (t - head_seen == Slots) { return false; }
+        }
+        slots[t & (Slots - 1)] = block;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: hands up to max published blocks to take, then frees their slots at once.
+    template <class Take>
+    std::uint32_t drain(Take&& take, std::uint32_t max) noexcept {
+        const std::uint32_t h = head.load(std::memory_order_relaxed);
+        const std::uint32_t n = std::min(tail.load(std::memory_order_acquire) - h, max);
+        for (std::uint32_t i = h; i != h + n; ++i) { take(slots[i & (Slots - 1)]); }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Consumer side: blocks published and not yet drained (a snapshot).
+    std::uint32_t pending() const noexcept {
+        return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed);
+    }
+
+    private:
+
+    alignas(64) std::atomic<std::uint32_t> tail{}; // written by the producer
+    std::uint32_t head_seen = 0; // producer's last look at head
+    const void* producer_;
+    alignas(64) std::atomic<std::uint32_t> head{}; // written by the consumer
+    alignas(64) std::array<void*, Slots> slots;
+};
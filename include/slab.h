@@ -1,32 +1,827 @@
 #pragma once
 #include "config.h"
+#include "cpu_cache.h"
 #include "thread_cache.h"
+#include "thread_registry.h"
+#include "maintenance.h"
 #include <mutex>
 #include <vector>
 #include <memory>
 #include "page_pool.h"
+#include "transfer_cache.h"
 #include <limits>
+#include <cstddef>
+#include <cstring>
 #include <atomic>
 
+// What free() does with a block allocated by another thread.
+enum class RemoteFreeMode : std::uint8_t {
+    Return, // send it back to the owner's inbox
+    Adopt,  // keep it in the freeing thread's cache (bounded by Config::adopt_max_cached)
+};
+
+// Every thread's registrations with live slabs of any config, and the set of live slabs.
+// A thread-exit hook retires the registrations of slabs still alive, holding the live set
+// so a slab cannot be destroyed underneath.
+class SlabThreads {
+    public:
 
-class slab {
+    struct Registration {
+        void* owner;
+        std::size_t epoch;
+        void* cache;
+        ThreadId id;
+        void (*retire)(void* owner, void* cache, ThreadId id) noexcept; // runs at thread exit
+    };
 
-    static ThreadCache* ensure_registered(slab* self) noexcept;
+    // A fresh epoch for a new slab (never reused), live until close().
+    static std::size_t open() noexcept;
+    static void close(std::size_t epoch) noexcept;
+    // This thread's registration with the slab of epoch, or nullptr.
+    static const Registration* find(std::size_t epoch) noexcept;
+    // Records a registration of this thread, dropping its ones with destroyed slabs.
+    static void add(const Registration& reg) noexcept;
+    // True once this thread's exit hook has started.
+    static bool retired() noexcept { return t_exit != Live; }
+    // True while this thread's exit hook runs, when the slabs must not be re-entered.
+    static bool retiring() noexcept { return t_exit == Retiring; }
+    // Holds the live set, for fork().
+    static void lock() noexcept;
+    static void unlock() noexcept;
 
-    [[gnu::always_inline]] inline constexpr SizeClassId get_bucket(SizeClassId size) noexcept {
-        for (SizeClassId i = 0; i < NumClasses; ++i) {
-            if (size <= sizes[i]) { return i; }
-        }
-        return static_cast<SizeClassId>(NumClasses);
+    // This thread's exit-hook state, written by the hook only. constinit in the header, so
+    // the checks above are plain TLS loads (the LD_PRELOAD interposer makes one per malloc).
+    enum ExitState : std::uint8_t { Live, Retiring, Retired };
+    static constinit inline thread_local ExitState t_exit = Live;
+};
+
+// A slab allocator tuned by a config policy (see default_config); `slab` is the default one.
+// Slabs of different configs share nothing but thread-exit bookkeeping.
+template <class Config = default_config>
+class basic_slab {
+    using C = config_traits<Config>;
+    using Cache = ThreadCache<Config>;
+
+    // The registration of the slab of this config this thread used last. Epochs are never
+    // reused and t_epoch is 0 whenever t_cache is null, so t_epoch == epoch alone validates
+    // t_cache; kept in the header for the compile-time fast paths. constinit: no TLS init
+    // call on access (an extern template would leave that call unresolved).
+    static constinit inline thread_local Cache* t_cache = nullptr;
+    static constinit inline thread_local std::size_t t_epoch = 0;
+    static constinit inline thread_local ThreadId t_id = 0;
+    // A cache made ahead of registering, kept if the registry recycles an id (and its cache).
+    static inline thread_local std::unique_ptr<Cache> t_local_cache;
+
+    static Cache* ensure_registered(basic_slab* self) noexcept;
+    // SlabThreads::Registration::retire for this config.
+    static void retire_thread(void* owner, void* cache, ThreadId id) noexcept;
+    // Returns a departing thread's blocks to the pool and frees its ThreadId for reuse.
+    void retire(Cache* cache, ThreadId id) noexcept;
+    // Returns blocks that reached the inboxes of exited threads' caches to the pool.
+    void reclaim_released() noexcept;
+    // Moves one batch from an over-full thread cache to the transfer cache (or the pool).
+    [[gnu::noinline]] void release_batch(Cache* cache, SizeClassId size_class) noexcept;
+    // Counts an overflow and releases batches until the class is back under its limit.
+    [[gnu::noinline]] void release_surplus(Cache* cache, SizeClassId size_class) noexcept;
+    // Slow-path prelude: grows the class limit, hands buffered remote frees back and
+    // drains returned blocks until the class holds want blocks (Config::drain_miss_steps
+    // steps, or want blocks, at most), releasing whatever that pushed over a limit.
+    [[gnu::noinline]] void prepare_refill(Cache* cache, SizeClassId size_class, std::size_t want = 1) noexcept;
+    // After a free onto the caller's cache: releases the surplus of an over-full class and,
+    // every Config::drain_interval frees, drains a step of returned blocks if enough wait.
+    // settle_free takes NumClasses when no class needs its limit checked.
+    [[gnu::always_inline]] inline void after_local_free(Cache* cache, SizeClassId size_class) noexcept {
+        if (cache->over_limit(size_class) | cache->tick_drain()) [[unlikely]] { settle_free(cache, size_class); }
     }
-    std::mutex registry_mutex;
-    std::vector<std::unique_ptr<ThreadCache>> registry;
-    PagePool pool;
+    [[gnu::noinline]] void settle_free(Cache* cache, SizeClassId size_class) noexcept;
+    // Drains up to max returned blocks and releases any class that pushed over its limit.
+    std::size_t drain_returned(Cache* cache, std::uint32_t max) noexcept;
+    // Moves one transfer-cache batch into the thread cache; false if there was none.
+    [[gnu::noinline]] bool take_transfer(Cache* cache, SizeClassId size_class) noexcept;
+    // Frees one block with the caller's cache in hand. Returns the class pushed onto the
+    // thread cache (for the caller's limit check) or NumClasses if it went elsewhere.
+    [[gnu::always_inline]] inline SizeClassId free_to(Cache* cache, void* ptr) noexcept;
+    // free_to once the block's class and owner entry are known.
+    [[gnu::always_inline]] inline SizeClassId free_owned(Cache* cache, ThreadId& owner_slot,
+                                                         void* ptr, SizeClassId size_class) noexcept;
+    // Sizes past max_small_size and alignments past max_class_align: one span per block,
+    // kept in the thread cache if there is one.
+    [[gnu::noinline]] void* alloc_large(Cache* cache, std::size_t size, std::size_t align) noexcept;
+    [[gnu::noinline]] void free_large(Cache* cache, Span* span) noexcept;
+    // Out-of-line runtime alloc, so the compile-time fast path stays a frameless tail call.
+    [[gnu::noinline]] void* alloc_miss(std::size_t size, std::size_t align) noexcept;
+    // Per-CPU mode (Config::per_cpu_caches): a refill of the current CPU's empty list from
+    // the transfer cache or the pool, returning one block; and a free onto its list, which
+    // hands a batch on once the list is full.
+    [[gnu::noinline]] void* cpu_refill(SizeClassId size_class) noexcept requires Config::per_cpu_caches;
+    [[gnu::always_inline]] inline void cpu_free(void* ptr, SizeClassId size_class) noexcept requires Config::per_cpu_caches;
+    [[gnu::noinline]] void cpu_overflow(void* ptr, SizeClassId size_class) noexcept requires Config::per_cpu_caches;
+    // Allocs and frees without a thread cache (exiting thread, or every ThreadId taken):
+    // one block at a time, straight from and to the pool.
+    [[gnu::noinline]] void* alloc_orphan(std::size_t size, std::size_t align) noexcept;
+    [[gnu::noinline]] void free_orphan(void* ptr) noexcept;
+    // Hands a chain of large spans from take_large back to the pool.
+    void put_large(Span* chain) noexcept;
+    // Per-thread byte budget for cache limits, shrinking as more threads register.
+    std::size_t thread_cache_budget() const noexcept;
+    // One pass of the maintenance thread (a MaintenanceThread::Pass): tops up the transfer
+    // cache of classes threads looked in, scavenges idle ones and exited threads' inboxes,
+    // prefaults and releases pages.
+    static void maintenance_pass(void* owner, MaintenanceThread& thread) noexcept;
+    // Carves a batch from the pool into the transfer cache, writing (so faulting in) every
+    // block as it links them; false if the class filled up meanwhile.
+    bool build_batch(SizeClassId size_class) noexcept;
+
+    ThreadRegistry<Config> registry;
+    TransferCache<Config> transfer;
+    PagePool<Config> pool;
+    [[no_unique_address]] std::conditional_t<Config::per_cpu_caches, CpuCaches<Config>, NoCpuCaches> cpus;
     const std::size_t epoch;
+    const RemoteFreeMode mode;
+    std::atomic<std::uint32_t> active_threads{0};
+    std::unique_ptr<MaintenanceThread> maintenance;
+    std::array<std::uint32_t, C::NumClasses> idle_passes{}; // per class, written by maintenance only
 
     public:
 
-    slab() noexcept;
-    void* alloc(SizeClassId size, std::size_t align) noexcept;
+    explicit basic_slab(RemoteFreeMode mode = RemoteFreeMode::Return,
+                  PageBacking backing = PageBacking::HugeArena) noexcept;
+    ~basic_slab() noexcept;
+    // nullptr when the OS refuses the memory.
+    void* alloc(std::size_t size, std::size_t align) noexcept;
+    // alloc with the first size bytes cleared, for calloc. Large spans fresh from the OS
+    // are left untouched, so their pages are only committed when first written.
+    void* alloc_zeroed(std::size_t size, std::size_t align) noexcept;
     void free(void* ptr) noexcept;
+    // Sized free: (size, align) as passed to alloc name the class, so the span descriptor
+    // is not read (only the block's owner entry).
+    void free(void* ptr, std::size_t size, std::size_t align) noexcept;
+    // Compile-time fast paths for a fixed (Size, Align): the class is a constant, so
+    // alloc is a TLS load, an epoch compare and a pop, and free an owner check and a push.
+    // Misses, large sizes, remote and unowned blocks take the runtime paths. The free skips
+    // the drain tick of the runtime frees (a counter update per free would double its cost),
+    // so returned blocks come back on misses and maintain().
+    template <std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+    [[gnu::always_inline]] inline void* alloc() noexcept {
+        constexpr SizeClassId size_class = C::get_bucket(Size, Align);
+        if constexpr (size_class < C::NumClasses && Config::per_cpu_caches) {
+            if (void* ptr = cpus.pop(size_class)) [[likely]] { return ptr; }
+        } else if constexpr (size_class < C::NumClasses) {
+            if (t_epoch == epoch) [[likely]] {
+                if (void* ptr = t_cache->pop(size_class)) [[likely]] { return ptr; }
+            }
+        }
+        return alloc_miss(Size, Align);
+    }
+    template <std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+    [[gnu::always_inline]] inline void free(void* ptr) noexcept {
+        constexpr SizeClassId size_class = C::get_bucket(Size, Align);
+        if (!ptr) {return;}
+        if constexpr (size_class < C::NumClasses && Config::per_cpu_caches) {
+            cpu_free(ptr, size_class);
+            return;
+        } else if constexpr (size_class < C::NumClasses) {
+            Span* span = span_of<C::page_size>(ptr);
+            if (t_epoch == epoch && span->owners()[span->index_in_class(ptr, C::class_layout[size_class])] == t_id) [[likely]] {
+                t_cache->push(size_class, ptr);
+                if (t_cache->over_limit(size_class)) [[unlikely]] { release_surplus(t_cache, size_class); }
+                return;
+            }
+        }
+        free(ptr, Size, Align);
+    }
+    // Bursts: one registration check and class lookup for n blocks, which come from whole
+    // list segments and a pool refill of exactly the shortfall. Returns blocks written to
+    // out (fewer than n only if the OS refused memory).
+    std::size_t alloc_batch(std::size_t size, std::size_t align, std::size_t n, void** out) noexcept;
+    // Frees n blocks; remote ones are grouped per owner and handed over before returning.
+    void free_batch(void* const* ptrs, std::size_t n) noexcept;
+    // Hands this thread's buffered remote frees to their owners; call at idle points.
+    void flush() noexcept;
+    // Tells the slab this thread will keep freeing blocks allocated by the thread that
+    // allocated ptr: opens a return ring to it now instead of after
+    // Config::return_ring_after remote batches. False in per-CPU mode, for large or own
+    // blocks, or when the owner has no ring slot left (frees then use its inbox).
+    bool pair_with(const void* ptr) noexcept;
+    // For idle points of event loops: hands this thread's buffered remote frees back and
+    // takes in every block returned to it, which allocs and frees otherwise only do a
+    // bounded step at a time; also returns blocks that reached exited threads to the pool.
+    // Returns blocks taken in.
+    std::size_t maintain() noexcept;
+    // For quiet periods: returns this thread's cached blocks and the transfer cache to the
+    // page pool, then hands every fully free page back to the OS. Returns bytes released.
+    std::size_t trim() noexcept;
+    // Fully free pages kept backed (not madvised) between trims; default Config::retain_empty_pages.
+    void set_page_retention(std::size_t pages) noexcept;
+    // Bytes usable at ptr (a block from this slab): its class size, or the rest of its span.
+    std::size_t usable_size(const void* ptr) const noexcept;
+    // Page pool lock acquisitions so far (refills, batches and returned blocks), for tuning.
+    std::uint64_t pool_lock_count() const noexcept;
+    // Starts a background thread that moves slow-path work off request threads (see
+    // MaintenanceOptions): refill batches built ahead of misses, pages faulted in ahead of
+    // refills, idle batches and surplus pages returned at a bounded rate. Thread caches
+    // stay owner-only, so it never touches them. False if one is running or it could not
+    // be started. Start and stop from one thread at a time; the destructor stops it.
+    // A forked child has no such thread: stop_maintenance() there restores inline release.
+    bool start_maintenance(const MaintenanceOptions& options = {}) noexcept;
+    void stop_maintenance() noexcept;
+    // Work of the running maintenance thread so far; zeros when none runs.
+    MaintenanceStats maintenance_stats() const noexcept;
+    // fork() support: prepare_fork takes every slab lock so no other thread holds one
+    // when the process is copied; finish_fork releases them (in parent and child).
+    void prepare_fork() noexcept;
+    void finish_fork() noexcept;
+    // True once this thread's exit hook has started; allocs then come straight from the pool.
+    static bool thread_retired() noexcept { return SlabThreads::retired(); }
+    // True while the hook runs: allocations made from inside it (by an interposed malloc
+    // the slab itself calls) must go elsewhere.
+    static bool thread_retiring() noexcept { return SlabThreads::retiring(); }
 };
+
+template <class Config>
+basic_slab<Config>::basic_slab(RemoteFreeMode mode, PageBacking backing) noexcept
+    : pool(backing), epoch(SlabThreads::open()), mode(mode) {}
+
+template <class Config>
+basic_slab<Config>::~basic_slab() noexcept {
+    stop_maintenance();
+    SlabThreads::close(epoch);
+}
+
+template <class Config>
+typename basic_slab<Config>::Cache* basic_slab<Config>::ensure_registered(basic_slab* self) noexcept {
+    if (t_epoch == self->epoch) {return t_cache;}
+    t_cache = nullptr;
+    t_epoch = 0;
+    if (SlabThreads::retired()) {return nullptr;} // later thread-exit hooks go through alloc_orphan and free_orphan
+
+    // switching between slabs reuses the earlier registration
+    if (const SlabThreads::Registration* r = SlabThreads::find(self->epoch)) {
+        t_id = r->id;
+        t_cache = static_cast<Cache*>(r->cache);
+        t_epoch = self->epoch;
+        return t_cache;
+    }
+
+    if (!t_local_cache) {
+        t_local_cache = std::make_unique<Cache>();
+    }
+
+    ThreadId id = 0;
+    Cache* cache = self->registry.add(t_local_cache, id);
+    if (!cache) {return nullptr;} // every ThreadId taken
+
+    self->active_threads.fetch_add(1, std::memory_order_relaxed);
+    SlabThreads::add({self, self->epoch, cache, id, &retire_thread});
+
+    t_id = id;
+    t_cache = cache;
+    t_epoch = self->epoch;
+    return t_cache;
+}
+
+template <class Config>
+void basic_slab<Config>::retire_thread(void* owner, void* cache, ThreadId id) noexcept {
+    static_cast<basic_slab*>(owner)->retire(static_cast<Cache*>(cache), id);
+    t_cache = nullptr;
+    t_epoch = 0;
+}
+
+template <class Config>
+void basic_slab<Config>::retire(Cache* cache, ThreadId id) noexcept {
+    cache->flush_remote();
+    cache->drain_remote();
+    for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+        pool.put_list(size_class, cache->take_all(size_class));
+    }
+    put_large(cache->take_large());
+    cache->reset_limits();
+    active_threads.fetch_sub(1, std::memory_order_relaxed);
+    registry.release(id);
+    reclaim_released(); // frees that raced with the release
+}
+
+template <class Config>
+void basic_slab<Config>::reclaim_released() noexcept {
+    registry.for_each_released([this](Cache* cache) {
+        if (cache->drain_remote() == 0) { return; }
+        for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+            pool.put_list(size_class, cache->take_all(size_class));
+        }
+    });
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::thread_cache_budget() const noexcept {
+    const std::size_t active = std::max<std::size_t>(active_threads.load(std::memory_order_relaxed), 1);
+    return std::clamp(C::total_thread_cache_bytes / active, C::min_thread_cache_bytes, C::max_thread_cache_bytes);
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::release_batch(Cache* cache, SizeClassId size_class) noexcept {
+    FreeNode* batch = cache->pop_batch(size_class, C::batch[size_class]);
+    if (!transfer.insert(size_class, batch)) { pool.put_list(size_class, batch); }
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::release_surplus(Cache* cache, SizeClassId size_class) noexcept {
+    cache->on_overflow(size_class);
+    while (cache->over_limit(size_class)) { release_batch(cache, size_class); }
+}
+
+template <class Config>
+void basic_slab<Config>::put_large(Span* chain) noexcept {
+    while (chain) {
+        Span* next = chain->next;
+        pool.put_span(chain);
+        chain = next;
+    }
+}
+
+template <class Config>
+[[gnu::noinline]] void* basic_slab<Config>::alloc_large(Cache* cache, std::size_t size, std::size_t align) noexcept {
+    if (align > C::page_size || size > (std::size_t{std::numeric_limits<std::uint32_t>::max()} - 1) * C::page_size) {
+        return nullptr;
+    }
+    const std::size_t first = std::max(span_header_bytes, std::bit_ceil(align));
+    const std::size_t pages = (first + size + C::page_size - 1) / C::page_size;
+
+    Span* span = cache && pages <= max_span_pages ? cache->pop_large(pages) : nullptr;
+    if (!span && (span = pool.get_span(pages)) == nullptr) { return nullptr; }
+    span->first = static_cast<std::uint32_t>(first);
+    return reinterpret_cast<std::byte*>(span) + first;
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::free_large(Cache* cache, Span* span) noexcept {
+    if (cache && span->pages <= max_span_pages && cache->push_large(span)) { return; }
+    pool.put_span(span);
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::drain_returned(Cache* cache, std::uint32_t max) noexcept {
+    const std::uint32_t taken = cache->drain_remote(max);
+    if (taken == 0) { return 0; }
+    for (SizeClassId c = 0; c < C::NumClasses; ++c) { // returned blocks may have pushed classes over
+        if (cache->over_limit(c)) { release_surplus(cache, c); }
+    }
+    return taken;
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::prepare_refill(Cache* cache, SizeClassId size_class, std::size_t want) noexcept {
+    cache->on_miss(size_class, thread_cache_budget());
+    cache->flush_remote();
+    // a batch may also drain as many blocks as it asks for, keeping the bound per block
+    std::size_t spent = 0;
+    for (std::uint32_t step = 0; cache->count(size_class) < want && (step < Config::drain_miss_steps || spent < want); ++step) {
+        const std::size_t taken = drain_returned(cache, Config::drain_step);
+        if (taken < Config::drain_step) { break; } // nothing more waiting
+        spent += taken;
+    }
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::settle_free(Cache* cache, SizeClassId size_class) noexcept {
+    if (size_class < C::NumClasses && cache->over_limit(size_class)) { release_surplus(cache, size_class); }
+    if (cache->drain_due()) {
+        cache->rearm_drain();
+        if (cache->remote_pending() >= Config::drain_threshold) { drain_returned(cache, Config::drain_step); }
+    }
+}
+
+template <class Config>
+[[gnu::noinline]] bool basic_slab<Config>::take_transfer(Cache* cache, SizeClassId size_class) noexcept {
+    FreeNode* batch = transfer.remove(size_class);
+    if (!batch) { return false; }
+    while (batch) {
+        FreeNode* next = batch->next;
+        owner_of<C::page_size>(batch) = t_id;
+        cache->push(size_class, batch);
+        batch = next;
+    }
+    return true;
+}
+
+template <class Config>
+void* basic_slab<Config>::alloc_zeroed(std::size_t size, std::size_t align) noexcept {
+    void* ptr = alloc(size, align);
+    if (!ptr) { return nullptr; }
+    const Span* span = span_of<C::page_size>(ptr);
+    if (span->size_class != C::large_class || !span->zeroed) { std::memset(ptr, 0, size); }
+    return ptr;
+}
+
+template <class Config>
+void* basic_slab<Config>::alloc(std::size_t size, size_t align) noexcept {
+    if constexpr (Config::per_cpu_caches) {
+        const SizeClassId size_class = C::get_bucket(size, align);
+        if (size_class >= C::NumClasses) [[unlikely]] {return alloc_large(nullptr, size, align);}
+        if (void* ptr = cpus.pop(size_class)) {return ptr;}
+        return cpu_refill(size_class);
+    }
+
+    Cache* cache = ensure_registered(this);
+    if (!cache) [[unlikely]] {return alloc_orphan(size, align);}
+    // blocks are naturally aligned, so alignment is met by the class C::get_bucket picks
+    SizeClassId size_class = C::get_bucket(size, align);
+    if (size_class >= C::NumClasses) [[unlikely]] {return alloc_large(cache, size, align);}
+
+
+    void* ptr = cache->pop(size_class);
+    if (ptr) {return ptr;}
+    ptr = cache->carve(size_class);
+    if (ptr) {return ptr;}
+
+    // fallback, also a good moment to hand buffered remote frees back
+
+    prepare_refill(cache, size_class);
+    void* drain_ptr = cache->pop(size_class);
+    if (drain_ptr) {return drain_ptr;}
+
+    // a whole batch released by another thread, before touching fresh pages
+
+    if (take_transfer(cache, size_class)) { return cache->pop(size_class); }
+
+    // another fallback but slower: returned blocks plus a page range carved on demand
+
+    FreeNode* list = nullptr;
+    std::byte* begin = nullptr;
+    std::byte* end = nullptr;
+    const std::size_t made = pool.refill(size_class, t_id, cache->refill_count(size_class), list, begin, end);
+    const std::size_t carvable = static_cast<std::size_t>(end - begin) / C::sizes[size_class];
+    cache->stock(size_class, list, static_cast<std::uint32_t>(made - carvable), begin, end); // stock the shelves
+
+    ptr = cache->pop(size_class);
+    return ptr ? ptr : cache->carve(size_class);
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::alloc_batch(std::size_t size, std::size_t align, std::size_t n, void** out) noexcept {
+    if constexpr (Config::per_cpu_caches) {
+        std::size_t made = 0;
+        while (made < n && (out[made] = alloc(size, align)) != nullptr) { ++made; }
+        return made;
+    }
+
+    Cache* cache = ensure_registered(this);
+    if (!cache) [[unlikely]] {
+        std::size_t made = 0;
+        while (made < n && (out[made] = alloc_orphan(size, align)) != nullptr) { ++made; }
+        return made;
+    }
+    const SizeClassId size_class = C::get_bucket(size, align);
+    if (size_class >= C::NumClasses) [[unlikely]] {
+        std::size_t made = 0;
+        while (made < n && (out[made] = alloc_large(cache, size, align)) != nullptr) { ++made; }
+        return made;
+    }
+
+    std::size_t made = cache->pop_many(size_class, out, n);
+    made += cache->carve_many(size_class, out + made, n - made);
+    if (made == n) {return made;}
+
+    // one slow path for the whole shortfall: inbox and transfer cache, then the pool
+    prepare_refill(cache, size_class, n - made);
+    made += cache->pop_many(size_class, out + made, n - made);
+    while (made < n && take_transfer(cache, size_class)) {
+        made += cache->pop_many(size_class, out + made, n - made);
+    }
+    if (made < n) { made += pool.get_batch(size_class, t_id, n - made, out + made); }
+    return made;
+}
+
+template <class Config>
+[[gnu::always_inline]] inline SizeClassId basic_slab<Config>::free_to(Cache* cache, void* ptr) noexcept {
+    Span* span = span_of<C::page_size>(ptr);
+    const SizeClassId size_class = span->size_class;
+    if (size_class == C::large_class) [[unlikely]] { free_large(cache, span); return C::NumClasses; }
+    return free_owned(cache, span->owners()[span->index_of(ptr)], ptr, size_class);
+}
+
+template <class Config>
+[[gnu::always_inline]] inline SizeClassId basic_slab<Config>::free_owned(Cache* cache, ThreadId& owner_slot,
+                                                           void* ptr, SizeClassId size_class) noexcept {
+    const ThreadId owner = owner_slot;
+
+    if (owner == t_id) {
+        cache->push(size_class, ptr);
+        return size_class;
+    }
+
+    // adopt: take ownership instead of bouncing the block back to its owner
+    if (mode == RemoteFreeMode::Adopt && cache->count(size_class) < Config::adopt_max_cached) {
+        owner_slot = t_id;
+        cache->push(size_class, ptr);
+        return size_class;
+    }
+
+    //remote free, lock-free lookup, buffered per owner
+    Cache* owner_cache = registry.find(owner);
+    if (owner_cache && !owner_cache->released()) [[likely]] {
+        cache->defer_remote(owner_cache, owner, ptr);
+        return C::NumClasses;
+    }
+
+    // the owner exited and nobody drains its inbox: keep the block (the caller's limit
+    // check hands any surplus on to the transfer cache)
+    owner_slot = t_id;
+    cache->push(size_class, ptr);
+    return size_class;
+}
+
+template <class Config>
+[[gnu::noinline]] void* basic_slab<Config>::cpu_refill(SizeClassId size_class) noexcept requires Config::per_cpu_caches {
+    FreeNode* chain = transfer.remove(size_class);
+    if (!chain) {
+        std::array<void*, std::ranges::max(C::batch)> blocks;
+        const std::size_t n = pool.get_batch(size_class, 0, C::batch[size_class], blocks.data()); // owner entries go unused
+        if (n == 0) {return nullptr;} // out of memory
+        for (std::size_t i = n; i-- > 0;) {
+            FreeNode* node = static_cast<FreeNode*>(blocks[i]);
+            node->next = chain;
+            chain = node;
+        }
+    }
+    // another thread on this CPU may have refilled first; the spare batch goes back
+    if (chain->next && !cpus.fill(size_class, chain->next)) { pool.put_list(size_class, chain->next); }
+    return chain;
+}
+
+template <class Config>
+[[gnu::always_inline]] inline void basic_slab<Config>::cpu_free(void* ptr, SizeClassId size_class) noexcept requires Config::per_cpu_caches {
+    if (!cpus.push(size_class, ptr, C::cache_max_length[size_class])) [[unlikely]] { cpu_overflow(ptr, size_class); }
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::cpu_overflow(void* ptr, SizeClassId size_class) noexcept requires Config::per_cpu_caches {
+    FreeNode* batch = cpus.push_overflow(size_class, ptr, C::batch[size_class]);
+    if (batch && !transfer.insert(size_class, batch)) { pool.put_list(size_class, batch); }
+}
+
+template <class Config>
+[[gnu::noinline]] void basic_slab<Config>::free_orphan(void* ptr) noexcept {
+    Span* span = span_of<C::page_size>(ptr);
+    if (span->size_class == C::large_class) { pool.put_span(span); return; }
+    FreeNode* node = static_cast<FreeNode*>(ptr);
+    node->next = nullptr;
+    pool.put_list(span->size_class, node);
+}
+
+template <class Config>
+[[gnu::noinline]] void* basic_slab<Config>::alloc_orphan(std::size_t size, std::size_t align) noexcept {
+    const SizeClassId size_class = C::get_bucket(size, align);
+    if (size_class >= C::NumClasses) {return alloc_large(nullptr, size, align);}
+    // owned by this thread's last id: a free elsewhere sends it to whichever cache holds
+    // that id, or keeps it once the id is released
+    void* ptr = nullptr;
+    pool.get_batch(size_class, t_id, 1, &ptr);
+    return ptr;
+}
+
+template <class Config>
+[[gnu::noinline]] void* basic_slab<Config>::alloc_miss(std::size_t size, std::size_t align) noexcept {
+    return alloc(size, align);
+}
+
+template <class Config>
+void basic_slab<Config>::free(void* ptr) noexcept {
+    if (!ptr) {std::cerr << "bad free ptr"; return;}
+
+    if constexpr (Config::per_cpu_caches) {
+        Span* span = span_of<C::page_size>(ptr);
+        if (span->size_class == C::large_class) [[unlikely]] {free_large(nullptr, span); return;}
+        cpu_free(ptr, span->size_class);
+        return;
+    }
+
+    Cache* cache = ensure_registered(this);
+    if (!cache) [[unlikely]] {free_orphan(ptr); return;}
+
+    const SizeClassId size_class = free_to(cache, ptr);
+    if (size_class < C::NumClasses) { after_local_free(cache, size_class); }
+}
+
+template <class Config>
+void basic_slab<Config>::free(void* ptr, std::size_t size, std::size_t align) noexcept {
+    if (!ptr) {return;}
+
+    if constexpr (Config::per_cpu_caches) {
+        const SizeClassId size_class = C::get_bucket(size, align);
+        if (size_class >= C::NumClasses) [[unlikely]] {free_large(nullptr, span_of<C::page_size>(ptr)); return;}
+        cpu_free(ptr, size_class);
+        return;
+    }
+
+    Cache* cache = ensure_registered(this);
+    if (!cache) [[unlikely]] {free_orphan(ptr); return;}
+
+    const SizeClassId size_class = C::get_bucket(size, align);
+    Span* span = span_of<C::page_size>(ptr);
+    if (size_class >= C::NumClasses) [[unlikely]] {free_large(cache, span); return;}
+    if (free_owned(cache, span->owners()[span->index_in_class(ptr, C::class_layout[size_class])], ptr, size_class) < C::NumClasses) {
+        after_local_free(cache, size_class);
+    }
+}
+
+template <class Config>
+void basic_slab<Config>::free_batch(void* const* ptrs, std::size_t n) noexcept {
+    if constexpr (Config::per_cpu_caches) {
+        for (std::size_t i = 0; i < n; ++i) { if (ptrs[i]) { free(ptrs[i]); } }
+        return;
+    }
+
+    Cache* cache = ensure_registered(this);
+    if (!cache) [[unlikely]] {
+        for (std::size_t i = 0; i < n; ++i) { if (ptrs[i]) { free_orphan(ptrs[i]); } }
+        return;
+    }
+
+    static_assert(C::NumClasses <= 64, "touched classes are tracked in a 64-bit mask");
+    std::uint64_t touched = 0;
+    std::uint32_t local = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!ptrs[i]) {continue;}
+        const SizeClassId size_class = free_to(cache, ptrs[i]);
+        if (size_class < C::NumClasses) {
+            touched |= std::uint64_t{1} << size_class;
+            ++local;
+        }
+    }
+
+    // limits are checked once per class, and each owner gets its chain in one CAS
+    while (touched) {
+        const auto size_class = static_cast<SizeClassId>(std::countr_zero(touched));
+        touched &= touched - 1;
+        if (cache->over_limit(size_class)) { release_surplus(cache, size_class); }
+    }
+    if (local && cache->tick_drain(local)) { settle_free(cache, C::NumClasses); }
+    cache->flush_remote();
+}
+
+template <class Config>
+void basic_slab<Config>::flush() noexcept {
+    if constexpr (Config::per_cpu_caches) {return;} // frees are never buffered
+    Cache* cache = ensure_registered(this);
+    if (!cache) {return;}
+    cache->flush_remote();
+}
+
+template <class Config>
+bool basic_slab<Config>::pair_with(const void* ptr) noexcept {
+    if constexpr (Config::per_cpu_caches) {return false;} // threads hold no blocks
+    Cache* cache = ensure_registered(this);
+    Span* span = span_of<C::page_size>(ptr);
+    if (!cache || span->size_class == C::large_class) {return false;}
+    const ThreadId owner = span->owners()[span->index_of(ptr)];
+    if (owner == t_id) {return false;}
+    Cache* owner_cache = registry.find(owner);
+    return owner_cache && !owner_cache->released() && cache->pair_with(owner_cache, owner);
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::maintain() noexcept {
+    if constexpr (Config::per_cpu_caches) {return 0;} // no thread caches, nothing returned to one
+    Cache* cache = ensure_registered(this);
+    if (!cache) {return 0;}
+    cache->flush_remote();
+    cache->rearm_drain();
+    reclaim_released();
+    return drain_returned(cache, std::numeric_limits<std::uint32_t>::max());
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::trim() noexcept {
+    if constexpr (Config::per_cpu_caches) {
+        // other CPUs' lists are only reachable from threads running there
+        for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+            pool.put_list(size_class, cpus.take_all(size_class));
+        }
+    }
+    Cache* cache = Config::per_cpu_caches ? nullptr : ensure_registered(this);
+    if (cache) {
+        cache->flush_remote();
+        cache->drain_remote();
+        for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+            pool.put_list(size_class, cache->take_all(size_class));
+        }
+        put_large(cache->take_large());
+    }
+    for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+        while (FreeNode* batch = transfer.reclaim(size_class)) { pool.put_list(size_class, batch); }
+    }
+    return pool.trim();
+}
+
+template <class Config>
+void basic_slab<Config>::set_page_retention(std::size_t pages) noexcept {
+    pool.set_retention(pages);
+}
+
+template <class Config>
+std::size_t basic_slab<Config>::usable_size(const void* ptr) const noexcept {
+    const Span* span = span_of<C::page_size>(ptr);
+    if (span->size_class == C::large_class) {
+        return std::size_t{span->pages} * C::page_size
+             - static_cast<std::size_t>(static_cast<const std::byte*>(ptr) - reinterpret_cast<const std::byte*>(span));
+    }
+    return C::sizes[span->size_class];
+}
+
+template <class Config>
+std::uint64_t basic_slab<Config>::pool_lock_count() const noexcept {
+    return pool.lock_count();
+}
+
+template <class Config>
+bool basic_slab<Config>::start_maintenance(const MaintenanceOptions& options) noexcept {
+    if (maintenance) {return false;}
+    maintenance = std::make_unique<MaintenanceThread>(options);
+    idle_passes.fill(0);
+    pool.defer_release(true);
+    if (maintenance->start(&maintenance_pass, this)) {return true;}
+    pool.defer_release(false);
+    maintenance.reset();
+    return false;
+}
+
+template <class Config>
+void basic_slab<Config>::stop_maintenance() noexcept {
+    if (!maintenance) {return;}
+    if (maintenance->stop()) {
+        maintenance.reset();
+    } else {
+        maintenance.release(); // a fork child's copy: the thread waiting on it lives in the parent
+    }
+    pool.defer_release(false);
+    pool.release_excess(std::numeric_limits<std::size_t>::max());
+}
+
+template <class Config>
+MaintenanceStats basic_slab<Config>::maintenance_stats() const noexcept {
+    return maintenance ? maintenance->stats() : MaintenanceStats{};
+}
+
+template <class Config>
+bool basic_slab<Config>::build_batch(SizeClassId size_class) noexcept {
+    std::array<void*, std::ranges::max(C::batch)> blocks;
+    const std::size_t n = pool.get_batch(size_class, 0, C::batch[size_class], blocks.data()); // take_transfer writes the owners
+    FreeNode* chain = nullptr;
+    for (std::size_t i = n; i-- > 0;) {
+        FreeNode* node = static_cast<FreeNode*>(blocks[i]);
+        node->next = chain;
+        chain = node;
+    }
+    if (n == C::batch[size_class] && transfer.insert(size_class, chain)) {return true;}
+    pool.put_list(size_class, chain);
+    return false;
+}
+
+template <class Config>
+void basic_slab<Config>::maintenance_pass(void* owner, MaintenanceThread& thread) noexcept {
+    basic_slab& self = *static_cast<basic_slab*>(owner);
+    const MaintenanceOptions& options = thread.options();
+    std::uint32_t budget = options.max_batches_per_pass;
+    for (SizeClassId size_class = 0; size_class < C::NumClasses; ++size_class) {
+        const auto [used, lookups] = self.transfer.level(size_class);
+        std::uint32_t& idle = self.idle_passes[size_class];
+        if (lookups > 0) { // a thread missed: have batches ready for the next miss
+            idle = 0;
+            const std::uint32_t ready = std::min(options.ready_batches, C::transfer_capacity[size_class]);
+            for (std::uint32_t have = used; have < ready && budget > 0; ++have, --budget) {
+                if (!self.build_batch(size_class)) {break;}
+                thread.count(thread.batches_built, 1);
+            }
+        } else if (used > 0 && ++idle >= options.idle_passes) {
+            idle = 0;
+            std::uint64_t scavenged = 0;
+            for (; FreeNode* batch = self.transfer.reclaim(size_class); ++scavenged) { self.pool.put_list(size_class, batch); }
+            thread.count(thread.batches_scavenged, scavenged);
+        }
+    }
+    if constexpr (!Config::per_cpu_caches) { self.reclaim_released(); }
+    thread.count(thread.pages_prefaulted, self.pool.prefault(options.prefault_pages));
+    thread.count(thread.pages_released, self.pool.release_excess(options.max_release_pages));
+}
+
+template <class Config>
+void basic_slab<Config>::prepare_fork() noexcept {
+    SlabThreads::lock();
+    registry.lock();
+    transfer.lock_all();
+    pool.lock_all();
+    if constexpr (Config::per_cpu_caches) { cpus.lock_all(); }
+}
+
+template <class Config>
+void basic_slab<Config>::finish_fork() noexcept {
+    if constexpr (Config::per_cpu_caches) { cpus.unlock_all(); }
+    pool.unlock_all();
+    transfer.unlock_all();
+    registry.unlock();
+    SlabThreads::unlock();
+}
+
+extern template class basic_slab<default_config>;
+extern template class basic_slab<per_cpu_config>;
+using slab = basic_slab<default_config>;
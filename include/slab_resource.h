@@ -0,0 +1,83 @@
+#pragma once
+#include "slab.h"
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+// Throws bad_alloc where exceptions are enabled; the slab itself is built without them.
+[[noreturn]] inline void slab_out_of_memory() {
+#if defined(__cpp_exceptions)
+    throw std::bad_alloc();
+#else
+    std::abort();
+#endif
+}
+
+// std::pmr adapter: pmr containers allocate from a slab (any basic_slab). Deallocation is
+// sized (pmr always passes the size and alignment), so frees skip the span descriptor. The
+// slab must outlive the resource; two resources compare equal only if they are the same
+// object (no RTTI).
+template <class Slab = slab>
+class slab_resource : public std::pmr::memory_resource {
+    Slab* backing;
+
+    void* do_allocate(std::size_t bytes, std::size_t align) override;
+    void do_deallocate(void* ptr, std::size_t bytes, std::size_t align) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    public:
+
+    explicit slab_resource(Slab& backing) noexcept : backing(&backing) {}
+    Slab& upstream() const noexcept { return *backing; }
+};
+
+// Allocator-requirements adapter for standard containers, with sized deallocation.
+// Copies (and rebinds) share the slab and compare equal when they point at the same one.
+template <class T, class Slab = slab>
+class slab_allocator {
+    Slab* backing;
+
+    template <class, class> friend class slab_allocator;
+
+    public:
+
+    using value_type = T;
+
+    explicit slab_allocator(Slab& backing) noexcept : backing(&backing) {}
+    template <class U>
+    slab_allocator(const slab_allocator<U, Slab>& other) noexcept : backing(other.backing) {}
+
+    [[nodiscard]] T* allocate(std::size_t n) {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) { slab_out_of_memory(); }
+        void* ptr = backing->alloc(n * sizeof(T), alignof(T));
+        if (!ptr) [[unlikely]] { slab_out_of_memory(); }
+        return static_cast<T*>(ptr);
+    }
+    void deallocate(T* ptr, std::size_t n) noexcept { backing->free(ptr, n * sizeof(T), alignof(T)); }
+
+    Slab& upstream() const noexcept { return *backing; }
+
+    template <class U>
+    bool operator==(const slab_allocator<U, Slab>& other) const noexcept { return backing == other.backing; }
+};
+
+template <class Slab>
+void* slab_resource<Slab>::do_allocate(std::size_t bytes, std::size_t align) {
+    void* ptr = backing->alloc(bytes, align);
+    if (!ptr) [[unlikely]] { slab_out_of_memory(); }
+    return ptr;
+}
+
+template <class Slab>
+void slab_resource<Slab>::do_deallocate(void* ptr, std::size_t bytes, std::size_t align) {
+    backing->free(ptr, bytes, align);
+}
+
+template <class Slab>
+bool slab_resource<Slab>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+extern template class slab_resource<slab>;
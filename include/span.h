@@ -0,0 +1,51 @@
+#pragma once
+#include "config.h"
+
+// Per-page metadata replacing per-block headers. A Span sits at the start of every
+// page_size-aligned page (page_size of the slab's config), followed by one owner ThreadId per block; blocks start at
+// class_layout[size_class].first. Any block pointer finds its span by masking.
+// A large span (size_class == large_class) covers `pages` pages and holds one block at
+// `first`, which may be page_size itself for page-aligned blocks.
+struct alignas(span_header_bytes) Span {
+    Span* prev;             // shard's partial list
+    Span* next;
+    FreeNode* free;         // blocks returned to the pool
+    std::uint32_t live;     // blocks handed out and not yet returned
+    std::uint32_t first;    // class_layout[size_class].first, copied to stay on this line
+    std::uint32_t recip;    // class_layout[size_class].recip
+    std::uint32_t pages;    // large spans: pages mapped
+    SizeClassId size_class;
+    bool in_partial;
+    bool zeroed;            // large spans: nothing past the header written since the OS zeroed it
+
+    [[gnu::always_inline]] inline ThreadId* owners() noexcept {
+        return reinterpret_cast<ThreadId*>(reinterpret_cast<std::byte*>(this) + span_header_bytes);
+    }
+
+    [[gnu::always_inline]] inline std::uint32_t index_of(const void* ptr) const noexcept {
+        const auto off = reinterpret_cast<std::uintptr_t>(ptr) - reinterpret_cast<std::uintptr_t>(this);
+        return static_cast<std::uint32_t>(((off - first) * recip) >> 32);
+    }
+
+    // index_of with the class's layout supplied by a caller that already knows the class
+    // (sized frees), so the descriptor line is not read.
+    [[gnu::always_inline]] inline std::uint32_t index_in_class(const void* ptr, const ClassLayout& layout) const noexcept {
+        const auto off = reinterpret_cast<std::uintptr_t>(ptr) - reinterpret_cast<std::uintptr_t>(this);
+        return static_cast<std::uint32_t>(((off - layout.first) * layout.recip) >> 32);
+    }
+};
+static_assert(sizeof(Span) == span_header_bytes, "owners start right after the descriptor");
+
+// Blocks never start at a page boundary except page-aligned large blocks, which sit
+// exactly one page past their span, so masking ptr - 1 finds the span either way.
+template <std::size_t PageSize = page_size>
+[[gnu::always_inline]] inline Span* span_of(const void* ptr) noexcept {
+    static_assert(std::has_single_bit(PageSize), "span_of masks by page_size");
+    return reinterpret_cast<Span*>((reinterpret_cast<std::uintptr_t>(ptr) - 1) & ~(PageSize - 1));
+}
+
+template <std::size_t PageSize = page_size>
+[[gnu::always_inline]] inline ThreadId& owner_of(const void* ptr) noexcept {
+    Span* span = span_of<PageSize>(ptr);
+    return span->owners()[span->index_of(ptr)];
+}
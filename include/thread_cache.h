@@ -1,11 +1,20 @@
 #pragma once
 #include "config.h"
 #include "remote_free.h"
+#include "return_ring.h"
+#include "span.h"
+#include <new>
 
 
+template <class Config = default_config>
 class ThreadCache { //represents memory that is free to be used.
+    using C = config_traits<Config>;
+
     public:
 
+    ThreadCache() noexcept = default;
+    ~ThreadCache() noexcept;
+
     [[gnu::always_inline]] inline void* pop(SizeClassId size_class) noexcept {
         Node* head = heads[size_class];
         if (!head) { return nullptr; }
@@ -20,17 +29,412 @@ class ThreadCache { //represents memory that is free to be used.
         heads[size_class] = node;
         ++counts[size_class];
     }
-    [[gnu::noinline]] void push_remote(void* ptr) noexcept;
-    [[gnu::noinline]] void drain_remote() noexcept;
+
+    // Next block of the class's uncarved range from PagePool::refill, or nullptr when it is
+    // used up. The block is first touched by the caller.
+    [[gnu::always_inline]] inline void* carve(SizeClassId size_class) noexcept {
+        std::byte* block = carve_next[size_class];
+        if (block == carve_end[size_class]) { return nullptr; }
+        carve_next[size_class] = block + C::sizes[size_class];
+        return static_cast<void*>(block);
+    }
+
+    // Carves up to n blocks into out; returns how many.
+    [[gnu::always_inline]] inline std::size_t carve_many(SizeClassId size_class, void** out, std::size_t n) noexcept {
+        std::size_t taken = 0;
+        for (; taken < n && carve_next[size_class] != carve_end[size_class]; ++taken) {
+            out[taken] = carve_next[size_class];
+            carve_next[size_class] += C::sizes[size_class];
+        }
+        return taken;
+    }
+
+    // Installs a refill into an empty class: a chain of count returned blocks becomes the
+    // free list as is, and [begin, end) the uncarved range.
+    void stock(SizeClassId size_class, FreeNode* list, std::uint32_t count, std::byte* begin, std::byte* end) noexcept;
+
+    // Pops up to n blocks into out in one walk of the list; returns how many.
+    [[gnu::always_inline]] inline std::size_t pop_many(SizeClassId size_class, void** out, std::size_t n) noexcept {
+        Node* node = heads[size_class];
+        std::size_t taken = 0;
+        for (; node && taken < n; ++taken) {
+            out[taken] = static_cast<void*>(node);
+            node = node->next;
+        }
+        heads[size_class] = node;
+        counts[size_class] -= static_cast<std::uint32_t>(taken);
+        return taken;
+    }
+
+    [[gnu::always_inline]] inline std::uint32_t count(SizeClassId size_class) const noexcept {
+        return counts[size_class];
+    }
+
+    [[gnu::always_inline]] inline bool over_limit(SizeClassId size_class) const noexcept {
+        return counts[size_class] > max_length[size_class];
+    }
+
+    // Blocks the next pool refill of the class asks for: from refill_floor up to a batch.
+    [[gnu::always_inline]] inline std::uint32_t refill_count(SizeClassId size_class) const noexcept {
+        return refill[size_class];
+    }
+
+    // Slow start: a miss grows the class limit by a batch while the thread stays within
+    // budget_bytes, and doubles the class refill if it missed recently, else halves it.
+    [[gnu::noinline]] void on_miss(SizeClassId size_class, std::size_t budget_bytes) noexcept;
+    // Decay: repeated overflows shrink the class limit by a batch and halve its refill.
+    [[gnu::noinline]] void on_overflow(SizeClassId size_class) noexcept;
+    // Back to one batch per class and the smallest refills, for a cache handed to a new thread.
+    void reset_limits() noexcept;
+
+    // The ThreadId this cache is registered under, set by ThreadRegistry.
+    void set_id(ThreadId id) noexcept { id_ = id; }
+    // Set while the cache's id is released (its thread exited and no thread took the id
+    // yet). Frees of its blocks then stay with the freeing thread, and chains already
+    // buffered for it come back to their sender's cache at the flush.
+    void set_released(bool released) noexcept { released_.store(released, std::memory_order_relaxed); }
+    bool released() const noexcept { return released_.load(std::memory_order_relaxed); }
+
+    // Hands back a block owned by another thread: through this cache's return ring into
+    // the owner when it has one with room, else buffered until the outgoing list reaches
+    // Config::remote_batch or flush_remote runs. Config::return_ring_after full batches in a row
+    // to one owner open the ring.
+    [[gnu::noinline]] void defer_remote(ThreadCache* owner, ThreadId owner_id, void* ptr) noexcept;
+    [[gnu::noinline]] void flush_remote() noexcept;
+    // Takes up to max returned blocks (inbox, then return rings) into this cache; returns
+    // how many. A stolen inbox chain left part-walked waits in a backlog for the next call.
+    [[gnu::noinline]] std::uint32_t drain_remote(std::uint32_t max = std::numeric_limits<std::uint32_t>::max()) noexcept;
+    // Returned blocks not yet drained; approximate, as remote threads keep adding.
+    std::uint32_t remote_pending() const noexcept;
+    // Counts one or n frees onto this cache; true once Config::drain_interval of them have
+    // passed since rearm_drain, when the owner should look at remote_pending.
+    [[gnu::always_inline]] inline bool tick_drain() noexcept { return --drain_countdown == 0; }
+    [[gnu::always_inline]] inline bool tick_drain(std::uint32_t n) noexcept {
+        drain_countdown = drain_countdown > n ? drain_countdown - n : 0;
+        return drain_countdown == 0;
+    }
+    [[gnu::always_inline]] inline bool drain_due() const noexcept { return drain_countdown == 0; }
+    void rearm_drain() noexcept { drain_countdown = Config::drain_interval; }
+    // Opens (or finds) this cache's return ring into owner's without waiting for the
+    // batches; false when the owner has no ring slot left.
+    bool pair_with(ThreadCache* owner, ThreadId owner_id) noexcept;
+    // Detaches up to n blocks of one class as a chain.
+    [[gnu::noinline]] FreeNode* pop_batch(SizeClassId size_class, std::size_t n) noexcept;
+    // Detaches the whole free list of one class, uncarved blocks included, leaving it empty.
+    [[gnu::noinline]] FreeNode* take_all(SizeClassId size_class) noexcept;
+
+    // Freed large spans of up to max_span_pages, kept for this thread within Config::large_cache_bytes.
+    [[gnu::noinline]] Span* pop_large(std::size_t pages) noexcept;
+    // False when the span would push the cache past Config::large_cache_bytes.
+    [[gnu::noinline]] bool push_large(Span* span) noexcept;
+    // Detaches every cached large span as a chain through Span::next.
+    [[gnu::noinline]] Span* take_large() noexcept;
 
     private:
 
-    struct Node {
-        Node* next;
+    using Node = FreeNode;
+    using Ring = ReturnRing<Config::return_ring_slots>;
+
+    struct Outgoing { // chain of blocks headed back to one owner
+        ThreadCache* owner;
+        Node* head;
+        Node* tail;
+        std::uint32_t count;
+        std::uint32_t batches; // full batches handed to owner since it took the slot
+        Ring* ring;            // into owner, once opened
     };
 
+    static constexpr std::array<std::uint32_t, C::NumClasses> initial_limits() noexcept {
+        return C::batch;
+    }
+
+    static constexpr std::size_t initial_limit_bytes() noexcept {
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < C::NumClasses; ++i) { bytes += std::size_t{C::sizes[i]} * C::batch[i]; }
+        return bytes;
+    }
+
+    void grow_refill(SizeClassId size_class) noexcept;
+    void shrink_refill(SizeClassId size_class) noexcept;
+    void push_remote_chain(Node* first, Node* last, std::uint32_t count) noexcept;
+    void flush_outgoing(Outgoing& out) noexcept;
+    // The outgoing slot for owner, handing over the chain of the owner it held before.
+    Outgoing& outgoing_to(ThreadCache* owner, ThreadId owner_id) noexcept;
+    // Called on the owner: producer's ring into this cache, taking a free slot for a new
+    // one if it has none; nullptr when the slots are all taken.
+    Ring* attach_ring(const ThreadCache* producer) noexcept;
+
     std::atomic<Node*> incoming_head{};
+    // Blocks pushed since the owner last stole the inbox: senders add after splicing and the
+    // owner zeroes it before stealing, so it may overcount but never misses a chain.
+    std::atomic<std::uint32_t> incoming_pending{};
+    Node* backlog = nullptr; // stolen from the inbox, not yet walked
+    std::uint32_t backlog_pending = 0; // incoming_pending at the steal, less what was walked
+    std::uint32_t drain_countdown = Config::drain_interval;
+    ThreadId id_ = 0;
+    std::atomic<bool> released_{false};
+    // Return rings into this cache, filled in order and kept while the cache lives: a ring
+    // belongs to a pair of caches, whichever threads hold them.
+    std::array<std::atomic<Ring*>, Config::return_rings> rings{};
 
-    std::array<Node*, NumClasses> heads{};
-    std::array<std::uint16_t, NumClasses> counts{};
+    std::array<Node*, C::NumClasses> heads{};
+    std::array<std::byte*, C::NumClasses> carve_next{};
+    std::array<std::byte*, C::NumClasses> carve_end{};
+    std::array<std::uint32_t, C::NumClasses> counts{};
+    std::array<std::uint32_t, C::NumClasses> max_length = initial_limits();
+    std::array<std::uint8_t, C::NumClasses> overflows{};
+    std::size_t limit_bytes = initial_limit_bytes(); // sum of max_length * size
+    std::array<std::uint32_t, C::NumClasses> refill = C::refill_floor;
+    std::array<std::uint32_t, C::NumClasses> last_miss{}; // miss_tick at the class's last miss, 0 never
+    std::uint32_t miss_tick = 0; // misses of every class so far
+    std::array<Outgoing, Config::remote_buffers> outgoing{};
+    std::array<Span*, max_span_pages + 1> large_heads{}; // by page count
+    std::size_t large_bytes = 0;
 };
+
+template <class Config>
+void ThreadCache<Config>::push_remote_chain(Node* first, Node* last, std::uint32_t count) noexcept {
+    RemoteFree::push_chain_MPSC(incoming_head, first, last);
+    incoming_pending.fetch_add(count, std::memory_order_relaxed);
+}
+
+template <class Config>
+void ThreadCache<Config>::flush_outgoing(Outgoing& out) noexcept {
+    if (out.count == 0) { return; }
+    if (out.owner->released()) { // nobody drains that inbox now: the blocks become ours
+        for (Node* node = out.head; node; node = node->next) { owner_of<C::page_size>(node) = id_; }
+        push_remote_chain(out.head, out.tail, out.count);
+    } else {
+        out.owner->push_remote_chain(out.head, out.tail, out.count);
+    }
+    out.head = nullptr;
+    out.tail = nullptr;
+    out.count = 0;
+}
+
+template <class Config>
+ThreadCache<Config>::~ThreadCache() noexcept {
+    for (auto& slot : rings) { delete slot.load(std::memory_order_relaxed); }
+}
+
+template <class Config>
+typename ThreadCache<Config>::Outgoing& ThreadCache<Config>::outgoing_to(ThreadCache* owner, ThreadId owner_id) noexcept {
+    Outgoing& out = outgoing[owner_id % Config::remote_buffers];
+    if (out.owner != owner) { // slot collision, hand the old chain over first
+        flush_outgoing(out);
+        out.owner = owner;
+        out.batches = 0;
+        out.ring = nullptr;
+    }
+    return out;
+}
+
+template <class Config>
+typename ThreadCache<Config>::Ring* ThreadCache<Config>::attach_ring(const ThreadCache* producer) noexcept {
+    for (auto& slot : rings) {
+        Ring* ring = slot.load(std::memory_order_acquire);
+        if (!ring) { break; }
+        if (ring->producer() == producer) { return ring; } // the slot collided since
+    }
+    Ring* fresh = nullptr;
+    for (auto& slot : rings) {
+        Ring* expected = nullptr;
+        if (slot.load(std::memory_order_relaxed)) { continue; }
+        if (!fresh && (fresh = new (std::nothrow) Ring(producer)) == nullptr) { return nullptr; }
+        if (slot.compare_exchange_strong(expected, fresh, std::memory_order_release, std::memory_order_relaxed)) {
+            return fresh;
+        }
+    }
+    delete fresh;
+    return nullptr;
+}
+
+template <class Config>
+[[gnu::noinline]] void ThreadCache<Config>::defer_remote(ThreadCache* owner, ThreadId owner_id, void* ptr) noexcept {
+    Outgoing& out = outgoing_to(owner, owner_id);
+    if (out.ring && out.ring->push(ptr)) { return; } // a full ring falls back to the inbox
+
+    Node* node = static_cast<Node*>(ptr);
+    node->next = out.head;
+    if (!out.head) { out.tail = node; }
+    out.head = node;
+
+    if (++out.count >= Config::remote_batch) {
+        flush_outgoing(out);
+        if constexpr (Config::return_rings > 0) {
+            if (!out.ring && ++out.batches == Config::return_ring_after) { out.ring = owner->attach_ring(this); }
+        }
+    }
+}
+
+template <class Config>
+bool ThreadCache<Config>::pair_with(ThreadCache* owner, ThreadId owner_id) noexcept {
+    if constexpr (Config::return_rings == 0) { return false; }
+    Outgoing& out = outgoing_to(owner, owner_id);
+    if (!out.ring) { out.ring = owner->attach_ring(this); }
+    return out.ring != nullptr;
+}
+
+template <class Config>
+[[gnu::noinline]] void ThreadCache<Config>::flush_remote() noexcept {
+    for (Outgoing& out : outgoing) { flush_outgoing(out); }
+}
+
+template <class Config>
+[[gnu::noinline]] std::uint32_t ThreadCache<Config>::drain_remote(std::uint32_t max) noexcept {
+    std::uint32_t taken = 0;
+    while (taken < max) {
+        if (!backlog) {
+            if (!incoming_head.load(std::memory_order_relaxed)) { break; }
+            backlog_pending = incoming_pending.exchange(0, std::memory_order_relaxed);
+            backlog = RemoteFree::steal_all(incoming_head);
+            continue;
+        }
+        Node* node = backlog;
+        backlog = node->next;
+        push(span_of<C::page_size>(node)->size_class, node);
+        ++taken;
+        backlog_pending = backlog && backlog_pending ? backlog_pending - 1 : 0;
+    }
+    for (auto& slot : rings) {
+        Ring* ring = slot.load(std::memory_order_acquire);
+        if (!ring || taken == max) { break; }
+        taken += ring->drain([this](void* block) { push(span_of<C::page_size>(block)->size_class, block); }, max - taken);
+    }
+    return taken;
+}
+
+template <class Config>
+std::uint32_t ThreadCache<Config>::remote_pending() const noexcept {
+    std::uint32_t pending = backlog_pending + incoming_pending.load(std::memory_order_relaxed);
+    for (const auto& slot : rings) {
+        const Ring* ring = slot.load(std::memory_order_acquire);
+        if (!ring) { break; }
+        pending += ring->pending();
+    }
+    return pending;
+}
+
+template <class Config>
+void ThreadCache<Config>::stock(SizeClassId size_class, FreeNode* list, std::uint32_t count, std::byte* begin, std::byte* end) noexcept {
+    heads[size_class] = list;
+    counts[size_class] = count;
+    carve_next[size_class] = begin;
+    carve_end[size_class] = end;
+}
+
+template <class Config>
+[[gnu::noinline]] FreeNode* ThreadCache<Config>::take_all(SizeClassId size_class) noexcept {
+    Node* list = heads[size_class];
+    heads[size_class] = nullptr;
+    counts[size_class] = 0;
+    while (void* block = carve(size_class)) { // only now are uncarved blocks written
+        Node* node = static_cast<Node*>(block);
+        node->next = list;
+        list = node;
+    }
+    carve_next[size_class] = carve_end[size_class] = nullptr;
+    return list;
+}
+
+template <class Config>
+[[gnu::noinline]] FreeNode* ThreadCache<Config>::pop_batch(SizeClassId size_class, std::size_t n) noexcept {
+    Node* head = heads[size_class];
+    Node* tail = nullptr;
+    std::size_t taken = 0;
+    for (Node* node = head; node && taken < n; node = node->next, ++taken) {
+        tail = node;
+    }
+    if (!tail) { return nullptr; }
+    heads[size_class] = tail->next;
+    tail->next = nullptr;
+    counts[size_class] -= static_cast<std::uint32_t>(taken);
+    return head;
+}
+
+template <class Config>
+void ThreadCache<Config>::grow_refill(SizeClassId size_class) noexcept {
+    refill[size_class] = std::min(refill[size_class] * 2, C::batch[size_class]);
+}
+
+template <class Config>
+void ThreadCache<Config>::shrink_refill(SizeClassId size_class) noexcept {
+    refill[size_class] = std::max(refill[size_class] / 2, C::refill_floor[size_class]);
+}
+
+template <class Config>
+[[gnu::noinline]] void ThreadCache<Config>::on_miss(SizeClassId size_class, std::size_t budget_bytes) noexcept {
+    if constexpr (Config::adaptive_refill) {
+        // a class missing again soon after its last miss runs hot; one that sat through
+        // refill_idle_misses of the thread's misses elsewhere has cooled down
+        if (const std::uint32_t last = last_miss[size_class]; last != 0) {
+            if (miss_tick - last <= Config::refill_idle_misses) { grow_refill(size_class); }
+            else { shrink_refill(size_class); }
+        }
+        if (++miss_tick == 0) { miss_tick = 1; } // 0 marks a class that never missed
+        last_miss[size_class] = miss_tick;
+    }
+    overflows[size_class] = 0;
+    if (max_length[size_class] >= C::cache_max_length[size_class]) { return; }
+    const std::size_t step = std::size_t{C::sizes[size_class]} * C::batch[size_class];
+    if (limit_bytes + step > budget_bytes) { return; }
+    max_length[size_class] += C::batch[size_class];
+    limit_bytes += step;
+}
+
+template <class Config>
+[[gnu::noinline]] void ThreadCache<Config>::on_overflow(SizeClassId size_class) noexcept {
+    if (++overflows[size_class] < cache_overflow_decay) { return; }
+    overflows[size_class] = 0;
+    if constexpr (Config::adaptive_refill) { shrink_refill(size_class); }
+    if (max_length[size_class] <= C::batch[size_class]) { return; }
+    max_length[size_class] -= C::batch[size_class];
+    limit_bytes -= std::size_t{C::sizes[size_class]} * C::batch[size_class];
+}
+
+template <class Config>
+void ThreadCache<Config>::reset_limits() noexcept {
+    max_length = initial_limits();
+    overflows = {};
+    limit_bytes = initial_limit_bytes();
+    refill = C::refill_floor;
+    last_miss = {};
+    miss_tick = 0;
+    rearm_drain();
+}
+
+template <class Config>
+[[gnu::noinline]] Span* ThreadCache<Config>::pop_large(std::size_t pages) noexcept {
+    Span* span = large_heads[pages];
+    if (!span) { return nullptr; }
+    large_heads[pages] = span->next;
+    large_bytes -= pages * C::page_size;
+    return span;
+}
+
+template <class Config>
+[[gnu::noinline]] bool ThreadCache<Config>::push_large(Span* span) noexcept {
+    const std::size_t bytes = std::size_t{span->pages} * C::page_size;
+    if (large_bytes + bytes > Config::large_cache_bytes) { return false; }
+    span->zeroed = false;
+    span->next = large_heads[span->pages];
+    large_heads[span->pages] = span;
+    large_bytes += bytes;
+    return true;
+}
+
+template <class Config>
+[[gnu::noinline]] Span* ThreadCache<Config>::take_large() noexcept {
+    Span* chain = nullptr;
+    for (Span*& head : large_heads) {
+        while (Span* span = head) {
+            head = span->next;
+            span->next = chain;
+            chain = span;
+        }
+    }
+    large_bytes = 0;
+    return chain;
+}
+
+extern template class ThreadCache<default_config>;
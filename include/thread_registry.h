@@ -0,0 +1,110 @@
+#pragma once
+#include "config.h"
+#include "thread_cache.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Maps ThreadId -> ThreadCache* for remote frees. Lookups are lock-free: slots are
+// atomics inside fixed-size chunks that are published once and never move or shrink.
+// Registration is serialized by mu_ and is the only writer.
+template <class Config = default_config>
+class ThreadRegistry {
+    using Cache = ThreadCache<Config>;
+    using Chunk = std::array<std::atomic<Cache*>, registry_chunk_size>;
+
+    std::array<std::atomic<Chunk*>, registry_chunks> chunks{};
+    std::size_t count = 0; // guarded by mu_
+    std::vector<ThreadId> free_ids; // released by exited threads, guarded by mu_
+    std::mutex mu_;
+
+    // Cache of an id already handed out, whose chunk always exists; callers hold mu_.
+    Cache* handed_out(ThreadId id) const noexcept {
+        return (*chunks[id / registry_chunk_size].load(std::memory_order_relaxed))[id % registry_chunk_size]
+            .load(std::memory_order_relaxed);
+    }
+
+    public:
+
+    ~ThreadRegistry() noexcept;
+
+    [[gnu::always_inline]] inline Cache* find(ThreadId id) const noexcept {
+        const Chunk* chunk = chunks[id / registry_chunk_size].load(std::memory_order_acquire);
+        if (!chunk) { return nullptr; }
+        return (*chunk)[id % registry_chunk_size].load(std::memory_order_acquire);
+    }
+
+    // Hands out the smallest released id together with its (emptied) cache, or else
+    // takes ownership of cache and publishes it under a fresh id.
+    // Returns nullptr (leaving cache untouched) once every ThreadId is in use.
+    Cache* add(std::unique_ptr<Cache>& cache, ThreadId& id) noexcept;
+
+    // Marks id reusable and its cache released (ThreadCache::released), so frees stop
+    // sending it blocks. The cache stays published: frees that raced with the release
+    // still land in its inbox, for for_each_released or the next thread given the id.
+    void release(ThreadId id) noexcept;
+
+    // Calls reclaim(cache) for the cache of every released id, holding the registration
+    // lock so none is handed to a new thread meanwhile.
+    template <class Reclaim>
+    void for_each_released(Reclaim&& reclaim) noexcept {
+        std::lock_guard<std::mutex> lock(mu_);
+        for (ThreadId id : free_ids) { reclaim(handed_out(id)); }
+    }
+
+    // Registration lock, for fork().
+    void lock() noexcept { mu_.lock(); }
+    void unlock() noexcept { mu_.unlock(); }
+};
+
+template <class Config>
+ThreadRegistry<Config>::~ThreadRegistry() noexcept {
+    for (auto& slot : chunks) {
+        Chunk* chunk = slot.load(std::memory_order_relaxed);
+        if (!chunk) { continue; }
+        for (auto& entry : *chunk) { delete entry.load(std::memory_order_relaxed); }
+        delete chunk;
+    }
+}
+
+template <class Config>
+ThreadCache<Config>* ThreadRegistry<Config>::add(std::unique_ptr<Cache>& cache, ThreadId& id) noexcept {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!free_ids.empty()) { // recycle, keeps owner_id small for pools that grow and shrink
+        auto it = std::min_element(free_ids.begin(), free_ids.end());
+        id = *it;
+        *it = free_ids.back();
+        free_ids.pop_back();
+        Cache* reused = handed_out(id);
+        reused->set_released(false);
+        return reused;
+    }
+    if (count >= registry_chunk_size * registry_chunks) { return nullptr; }
+
+    const std::size_t idx = count;
+    auto& chunk_slot = chunks[idx / registry_chunk_size];
+    Chunk* chunk = chunk_slot.load(std::memory_order_relaxed);
+    if (!chunk) {
+        chunk = new Chunk{};
+        chunk_slot.store(chunk, std::memory_order_release);
+    }
+
+    Cache* raw = cache.release();
+    id = static_cast<ThreadId>(idx);
+    raw->set_id(id);
+    (*chunk)[idx % registry_chunk_size].store(raw, std::memory_order_release);
+    ++count;
+    return raw;
+}
+
+template <class Config>
+void ThreadRegistry<Config>::release(ThreadId id) noexcept {
+    std::lock_guard<std::mutex> lock(mu_);
+    handed_out(id)->set_released(true);
+    free_ids.push_back(id);
+}
+
+extern template class ThreadRegistry<default_config>;
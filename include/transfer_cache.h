@@ -0,0 +1,86 @@
+#pragma once
+#include "config.h"
+#include <array>
+#include <mutex>
+
+// Central per-class store of whole free-block batches shared by all threads of a slab.
+// Each class has its own lock and cache line, so classes never contend with each other.
+template <class Config = default_config>
+class TransferCache {
+    using C = config_traits<Config>;
+
+    struct alignas(64) ClassCache {
+        std::mutex mu;
+        std::uint32_t used = 0;
+        std::uint32_t lookups = 0; // remove() calls since the last level()
+        std::array<FreeNode*, Config::transfer_slots> batches{};
+    };
+
+    std::array<ClassCache, C::NumClasses> classes;
+
+    public:
+
+    struct Level {
+        std::uint32_t used;    // batches held
+        std::uint32_t lookups; // remove() calls since the previous level()
+    };
+
+    // Returns false when the class is full; the caller keeps the batch.
+    bool insert(SizeClassId size_class, FreeNode* batch) noexcept;
+    // Most recently inserted batch, or nullptr.
+    FreeNode* remove(SizeClassId size_class) noexcept;
+    // remove() for the maintenance thread: not counted as a lookup.
+    FreeNode* reclaim(SizeClassId size_class) noexcept;
+    // The class's fill and demand, restarting the lookup count.
+    Level level(SizeClassId size_class) noexcept;
+    // Every class lock, for fork().
+    void lock_all() noexcept;
+    void unlock_all() noexcept;
+};
+
+template <class Config>
+bool TransferCache<Config>::insert(SizeClassId size_class, FreeNode* batch) noexcept {
+    ClassCache& cc = classes[size_class];
+    std::lock_guard<std::mutex> lk(cc.mu);
+    if (cc.used >= C::transfer_capacity[size_class]) { return false; }
+    cc.batches[cc.used++] = batch;
+    return true;
+}
+
+template <class Config>
+FreeNode* TransferCache<Config>::remove(SizeClassId size_class) noexcept {
+    ClassCache& cc = classes[size_class];
+    std::lock_guard<std::mutex> lk(cc.mu);
+    ++cc.lookups;
+    if (cc.used == 0) { return nullptr; }
+    return cc.batches[--cc.used];
+}
+
+template <class Config>
+FreeNode* TransferCache<Config>::reclaim(SizeClassId size_class) noexcept {
+    ClassCache& cc = classes[size_class];
+    std::lock_guard<std::mutex> lk(cc.mu);
+    if (cc.used == 0) { return nullptr; }
+    return cc.batches[--cc.used];
+}
+
+template <class Config>
+typename TransferCache<Config>::Level TransferCache<Config>::level(SizeClassId size_class) noexcept {
+    ClassCache& cc = classes[size_class];
+    std::lock_guard<std::mutex> lk(cc.mu);
+    const Level now{cc.used, cc.lookups};
+    cc.lookups = 0;
+    return now;
+}
+
+template <class Config>
+void TransferCache<Config>::lock_all() noexcept {
+    for (ClassCache& cc : classes) { cc.mu.lock(); }
+}
+
+template <class Config>
+void TransferCache<Config>::unlock_all() noexcept {
+    for (ClassCache& cc : classes) { cc.mu.unlock(); }
+}
+
+extern template class TransferCache<default_config>;
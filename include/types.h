@@ -7,11 +7,7 @@ using SizeClassId = std::uint16_t;
 using ThreadId = std::uint16_t;
 
 
-struct BlockHeader {
-    ThreadId owner_id;
-    SizeClassId size_id;
+// Intrusive link stored in the first word of a free block.
+struct FreeNode {
+    FreeNode* next;
 };
-
-inline BlockHeader* header_from_user_ptr(void* ptr) noexcept {
-    return reinterpret_cast<BlockHeader*>(static_cast<std::byte*>(ptr) - sizeof(BlockHeader));
-}
\ No newline at end of file
@@ -9,11 +9,17 @@ make -C "$ROOT" benches
 declare -a benches=(
   "bench_basic"
   "bench_alignment"
+  "bench_alignment_wide"
   "bench_remote"
   "bench_four_thread"
   "bench_multialign"
   "bench_remote_six"
   "bench_remote_many_to_one"
+  "bench_tlb"
+  "bench_layout"
+  "bench_batch"
+  "bench_pmr"
+  "bench_maintenance"
 )
 
 for b in "${benches[@]}"; do
@@ -0,0 +1,18 @@
+#include "../include/cpu_cache.h"
+#include <sys/sysinfo.h>
+
+bool rseq_available() noexcept {
+#ifdef SLAB_HAVE_RSEQ
+    static const bool registered = __rseq_size >= 20 && Rseq::current_cpu() >= 0;
+    return registered;
+#else
+    return false;
+#endif
+}
+
+std::size_t cpu_slots() noexcept {
+    static const std::size_t slots = static_cast<std::size_t>(std::max(get_nprocs_conf(), 1));
+    return slots;
+}
+
+template class CpuCaches<per_cpu_config>;
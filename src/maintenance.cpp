@@ -0,0 +1,67 @@
+#include "../include/maintenance.h"
+#include <sched.h>
+#include <unistd.h>
+
+bool MaintenanceThread::start(Pass pass, void* owner) noexcept {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (running_) { return false; }
+    pass_ = pass;
+    owner_ = owner;
+    stopping_ = false;
+
+    pthread_attr_t attr;
+    if (::pthread_attr_init(&attr) != 0) { return false; }
+    bool ok = true;
+    if (options_.cpu >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        if (options_.cpu >= CPU_SETSIZE) { ok = false; }
+        else {
+            CPU_SET(options_.cpu, &cpus);
+            ok = ::pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus) == 0;
+        }
+    }
+    ok = ok && ::pthread_create(&thread_, &attr, &MaintenanceThread::run, this) == 0;
+    ::pthread_attr_destroy(&attr);
+    if (!ok) { return false; }
+    running_ = true;
+    pid_ = ::getpid();
+    return true;
+}
+
+bool MaintenanceThread::stop() noexcept {
+    // the child of a fork has no such thread, and its copy of mu_ may be held
+    if (running_ && pid_ != ::getpid()) {
+        running_ = false;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lk(mu_);
+        if (!running_) { return true; }
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    ::pthread_join(thread_, nullptr);
+    std::lock_guard<std::mutex> lk(mu_);
+    running_ = false;
+    return true;
+}
+
+MaintenanceStats MaintenanceThread::stats() const noexcept {
+    return {passes.load(std::memory_order_relaxed), batches_built.load(std::memory_order_relaxed),
+            pages_prefaulted.load(std::memory_order_relaxed), batches_scavenged.load(std::memory_order_relaxed),
+            pages_released.load(std::memory_order_relaxed)};
+}
+
+void* MaintenanceThread::run(void* arg) noexcept {
+    auto* self = static_cast<MaintenanceThread*>(arg);
+    std::unique_lock<std::mutex> lk(self->mu_);
+    while (!self->stopping_) {
+        lk.unlock();
+        self->pass_(self->owner_, *self);
+        self->count(self->passes, 1);
+        lk.lock();
+        self->cv_.wait_for(lk, self->options_.period, [self] { return self->stopping_; });
+    }
+    return nullptr;
+}
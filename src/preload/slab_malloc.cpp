@@ -0,0 +1,310 @@
+// LD_PRELOAD interposer: malloc/free and friends plus the global operator new/delete,
+// all served by one process-global slab. Built as out/libslab_malloc.so (make preload):
+//
+//     LD_PRELOAD=out/libslab_malloc.so ./program
+//
+// The slab's own bookkeeping (vectors, thread caches, registry chunks) also calls malloc;
+// those nested calls, and any made before the slab exists, are served by a small
+// bootstrap allocator over a reserved range, which free() recognizes by address. So are
+// threads past their exit hook and alignments beyond page_size.
+#include "../../include/slab.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define SLAB_EXPORT extern "C" __attribute__((visibility("default")))
+
+namespace {
+
+// ---- bootstrap allocator ----------------------------------------------------------------
+// Power-of-two blocks carved from one reservation, recycled through per-class free lists.
+// Each block starts with a 16-byte header holding its class and the user offset.
+
+constexpr std::size_t boot_bytes = std::size_t{256} << 20; //256MB, reserved not committed
+constexpr std::size_t boot_header = 16;
+constexpr std::size_t boot_classes = 28; // 16B .. 2GB
+
+struct BootHeader {
+    std::uint32_t cls;
+    std::uint32_t offset; // user pointer - block start
+};
+
+std::atomic_flag boot_lock = ATOMIC_FLAG_INIT;
+std::atomic<std::byte*> boot_base{nullptr}; // set once; read unlocked by free()
+std::byte* boot_cursor = nullptr;
+std::byte* boot_end = nullptr;
+std::array<void*, boot_classes> boot_free{};
+
+struct BootGuard {
+    BootGuard() noexcept { while (boot_lock.test_and_set(std::memory_order_acquire)) {} }
+    ~BootGuard() { boot_lock.clear(std::memory_order_release); }
+};
+
+inline bool is_boot(const void* ptr) noexcept {
+    const auto* p = static_cast<const std::byte*>(ptr);
+    const std::byte* base = boot_base.load(std::memory_order_acquire);
+    return base && p >= base && p < base + boot_bytes;
+}
+
+inline BootHeader* boot_header_of(void* ptr) noexcept {
+    return reinterpret_cast<BootHeader*>(static_cast<std::byte*>(ptr) - sizeof(BootHeader));
+}
+
+void* boot_alloc(std::size_t size, std::size_t align) noexcept {
+    align = std::max(align, boot_header);
+    if (size > boot_bytes || align > boot_bytes / 2) { return nullptr; }
+    const std::size_t need = size + align + boot_header;
+    const std::size_t cls = static_cast<std::size_t>(std::bit_width(std::max<std::size_t>(need, 16) - 1)) - 4;
+    if (cls >= boot_classes) { return nullptr; }
+    const std::size_t block_bytes = std::size_t{16} << cls;
+
+    std::byte* block = nullptr;
+    {
+        BootGuard guard;
+        if (!boot_base.load(std::memory_order_relaxed)) {
+            void* p = ::mmap(nullptr, boot_bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (p == MAP_FAILED) { return nullptr; }
+            boot_cursor = static_cast<std::byte*>(p);
+            boot_end = boot_cursor + boot_bytes;
+            boot_base.store(boot_cursor, std::memory_order_release);
+        }
+        if (boot_free[cls]) {
+            block = static_cast<std::byte*>(boot_free[cls]);
+            boot_free[cls] = *reinterpret_cast<void**>(block);
+        } else if (static_cast<std::size_t>(boot_end - boot_cursor) >= block_bytes) {
+            block = boot_cursor;
+            boot_cursor += block_bytes;
+        } else {
+            return nullptr;
+        }
+    }
+
+    auto user = reinterpret_cast<std::uintptr_t>(block) + boot_header;
+    user = (user + align - 1) & ~(align - 1);
+    auto* ptr = reinterpret_cast<void*>(user);
+    *boot_header_of(ptr) = BootHeader{static_cast<std::uint32_t>(cls),
+                                      static_cast<std::uint32_t>(user - reinterpret_cast<std::uintptr_t>(block))};
+    return ptr;
+}
+
+std::size_t boot_usable(void* ptr) noexcept {
+    const BootHeader h = *boot_header_of(ptr);
+    return (std::size_t{16} << h.cls) - h.offset;
+}
+
+void boot_free_block(void* ptr) noexcept {
+    const BootHeader h = *boot_header_of(ptr);
+    std::byte* block = static_cast<std::byte*>(ptr) - h.offset;
+    BootGuard guard;
+    *reinterpret_cast<void**>(block) = boot_free[h.cls];
+    boot_free[h.cls] = block;
+}
+
+// ---- process-global slab ----------------------------------------------------------------
+
+enum : int { Uninit, Initializing, Ready };
+std::atomic<int> state{Uninit};
+alignas(slab) unsigned char slab_storage[sizeof(slab)];
+
+// Depth of slab calls on this thread; nested mallocs go to the bootstrap allocator.
+// initial-exec keeps the access itself from allocating.
+__attribute__((tls_model("initial-exec"))) thread_local int t_depth = 0;
+
+struct Nested {
+    Nested() noexcept { ++t_depth; }
+    ~Nested() { --t_depth; }
+};
+
+inline slab& global() noexcept { return *std::launder(reinterpret_cast<slab*>(slab_storage)); }
+
+void before_fork() noexcept {
+    if (state.load(std::memory_order_acquire) == Ready) { global().prepare_fork(); }
+    while (boot_lock.test_and_set(std::memory_order_acquire)) {}
+}
+
+void after_fork() noexcept {
+    boot_lock.clear(std::memory_order_release);
+    if (state.load(std::memory_order_acquire) == Ready) { global().finish_fork(); }
+}
+
+// The global slab, created on first use and never destroyed (free() may run after exit
+// handlers). nullptr while this thread is inside the slab or another thread builds it.
+[[gnu::noinline]] slab* init_global() noexcept {
+    int expected = Uninit;
+    if (!state.compare_exchange_strong(expected, Initializing, std::memory_order_acq_rel)) { return nullptr; }
+    {
+        Nested nested;
+        ::new (slab_storage) slab(RemoteFreeMode::Return, PageBacking::HugeArena);
+        ::pthread_atfork(before_fork, after_fork, after_fork);
+    }
+    state.store(Ready, std::memory_order_release);
+    return &global();
+}
+
+[[gnu::always_inline]] inline slab* usable_slab() noexcept {
+    if (t_depth | slab::thread_retiring()) [[unlikely]] { return nullptr; }
+    if (state.load(std::memory_order_acquire) == Ready) [[likely]] { return &global(); }
+    return init_global();
+}
+
+void* allocate(std::size_t size, std::size_t align) noexcept {
+    if (slab* s = usable_slab()) {
+        Nested nested;
+        if (void* p = s->alloc(size ? size : 1, align)) { return p; }
+    }
+    return boot_alloc(size, align); // nested, early, in a thread-exit hook, or past the slab's reach
+}
+
+// allocate with the block cleared; fresh large spans are known zero and left untouched
+void* allocate_zeroed(std::size_t size, std::size_t align) noexcept {
+    if (slab* s = usable_slab()) {
+        Nested nested;
+        if (void* p = s->alloc_zeroed(size ? size : 1, align)) { return p; }
+    }
+    void* p = boot_alloc(size, align);
+    if (p) { std::memset(p, 0, size); }
+    return p;
+}
+
+void release(void* ptr) noexcept {
+    if (!ptr) { return; }
+    if (is_boot(ptr)) { boot_free_block(ptr); return; }
+    Nested nested;
+    global().free(ptr); // only the slab hands out other pointers
+}
+
+std::size_t usable(void* ptr) noexcept {
+    if (is_boot(ptr)) { return boot_usable(ptr); }
+    return global().usable_size(ptr);
+}
+
+void* allocate_or_errno(std::size_t size, std::size_t align) noexcept {
+    void* p = allocate(size, align);
+    if (!p) { errno = ENOMEM; }
+    return p;
+}
+
+bool valid_align(std::size_t align) noexcept {
+    return align >= sizeof(void*) && std::has_single_bit(align);
+}
+
+void* reallocate(void* ptr, std::size_t size) noexcept {
+    if (!ptr) { return allocate_or_errno(size, alignof(std::max_align_t)); }
+    if (size == 0) { release(ptr); return nullptr; }
+    const std::size_t have = usable(ptr);
+    if (size <= have && (size >= have / 2 || have <= max_small_size)) { return ptr; }
+    void* fresh = allocate_or_errno(size, alignof(std::max_align_t));
+    if (!fresh) { return nullptr; }
+    std::memcpy(fresh, ptr, std::min(size, have));
+    release(ptr);
+    return fresh;
+}
+
+void* new_or_throw(std::size_t size, std::size_t align) {
+    for (;;) {
+        if (void* p = allocate(size, align)) { return p; }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) { throw std::bad_alloc(); }
+        handler();
+    }
+}
+
+}
+
+// ---- C allocation API -------------------------------------------------------------------
+
+SLAB_EXPORT void* malloc(std::size_t size) {
+    return allocate_or_errno(size, alignof(std::max_align_t));
+}
+
+SLAB_EXPORT void free(void* ptr) {
+    release(ptr);
+}
+
+SLAB_EXPORT void* calloc(std::size_t count, std::size_t size) {
+    std::size_t bytes = 0;
+    if (__builtin_mul_overflow(count, size, &bytes)) { errno = ENOMEM; return nullptr; }
+    void* p = allocate_zeroed(bytes, alignof(std::max_align_t));
+    if (!p) { errno = ENOMEM; }
+    return p;
+}
+
+SLAB_EXPORT void* realloc(void* ptr, std::size_t size) {
+    return reallocate(ptr, size);
+}
+
+SLAB_EXPORT void* reallocarray(void* ptr, std::size_t count, std::size_t size) {
+    std::size_t bytes = 0;
+    if (__builtin_mul_overflow(count, size, &bytes)) { errno = ENOMEM; return nullptr; }
+    return reallocate(ptr, bytes);
+}
+
+SLAB_EXPORT int posix_memalign(void** out, std::size_t align, std::size_t size) {
+    if (!valid_align(align)) { return EINVAL; }
+    void* p = allocate(size, align);
+    if (!p) { return ENOMEM; }
+    *out = p;
+    return 0;
+}
+
+SLAB_EXPORT void* aligned_alloc(std::size_t align, std::size_t size) {
+    if (!std::has_single_bit(align)) { errno = EINVAL; return nullptr; }
+    return allocate_or_errno(size, align);
+}
+
+SLAB_EXPORT void* memalign(std::size_t align, std::size_t size) {
+    return allocate_or_errno(size, std::bit_ceil(std::max<std::size_t>(align, 1)));
+}
+
+SLAB_EXPORT void* valloc(std::size_t size) {
+    return allocate_or_errno(size, static_cast<std::size_t>(::sysconf(_SC_PAGESIZE)));
+}
+
+SLAB_EXPORT void* pvalloc(std::size_t size) {
+    const auto os_page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return allocate_or_errno((size + os_page - 1) & ~(os_page - 1), os_page);
+}
+
+SLAB_EXPORT std::size_t malloc_usable_size(void* ptr) {
+    return ptr ? usable(ptr) : 0;
+}
+
+// ---- global operator new/delete ---------------------------------------------------------
+
+void* operator new(std::size_t size) { return new_or_throw(size, alignof(std::max_align_t)); }
+void* operator new[](std::size_t size) { return new_or_throw(size, alignof(std::max_align_t)); }
+void* operator new(std::size_t size, std::align_val_t align) { return new_or_throw(size, static_cast<std::size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return new_or_throw(size, static_cast<std::size_t>(align)); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(align));
+}
+
+// sized and aligned forms all go through free(): the span already knows the class
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
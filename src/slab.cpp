@@ -1,91 +1,72 @@
 #include "../include/slab.h"
-#include <iostream>
+#include <algorithm>
 
 namespace {
-    thread_local ThreadCache* t_cache = nullptr;
-    thread_local ThreadId t_id = 0;
-    thread_local std::unique_ptr<ThreadCache> t_local_cache;
-    thread_local slab* t_owner = nullptr;
-    thread_local std::size_t t_epoch = 0;
     std::atomic<std::size_t> global_epoch{1};
 
-    // Canonicalize alignment to the three supported choices.
-    inline std::size_t normalize_align(std::size_t align) noexcept {
-        if (align >= 64) { return 64; }
-        if (align >= 16) { return 16; }
-        return 1;
-    }
-}
-
-ThreadCache* slab::ensure_registered(slab* self) noexcept {
-    if (t_cache && t_owner == self && t_epoch == self->epoch) {return t_cache;}
-    t_cache = nullptr;
+    // Epochs of slabs that are still alive. Thread-exit hooks hold live_mutex while
+    // touching a slab's caches, so ~basic_slab cannot tear them down underneath.
+    std::mutex live_mutex;
+    std::vector<std::size_t> live_epochs;
 
-    if (!t_local_cache) {
-        t_local_cache = std::make_unique<ThreadCache>();
+    inline bool is_live(std::size_t epoch) noexcept {
+        return std::find(live_epochs.begin(), live_epochs.end(), epoch) != live_epochs.end();
     }
 
-    std::lock_guard<std::mutex> lock(self->registry_mutex);
-    t_id = static_cast<ThreadId>(self->registry.size());
-    self->registry.push_back(std::move(t_local_cache));
-    t_cache = self->registry.back().get();
-    t_owner = self;
-    t_epoch = self->epoch;
-    return t_cache;
-}
-
-slab::slab() noexcept : epoch(global_epoch.fetch_add(1, std::memory_order_relaxed)) {}
-
-void* slab::alloc(SizeClassId size, size_t align) noexcept {
-    ThreadCache* cache = ensure_registered(this);
-    const std::size_t block_align = normalize_align(align);
-
-    SizeClassId size_class = get_bucket(size);
-    if (size_class >= NumClasses) {return nullptr;}
-
-
-    void* ptr = cache->pop(size_class);
-    if (ptr) {return ptr;}
-
-    // fallback
-
-    cache->drain_remote();
-    void* drain_ptr = cache->pop(size_class);
-    if (drain_ptr) {return drain_ptr;}
-
-    // another fallback but slower
-
-    std::vector<void*> batch;
-    batch.reserve(blocks_per_bin);
-    pool.get_batch(size_class, t_id, blocks_per_bin, batch, block_align);
-
-    for (void* page : batch) {
-        cache->push(size_class, page); // stock the shelves
-    }
+    struct ThreadState {
+        // Every slab this thread has registered with; retired when the thread exits.
+        std::vector<SlabThreads::Registration> regs;
+
+        ~ThreadState() {
+            SlabThreads::t_exit = SlabThreads::Retiring;
+            {
+                std::lock_guard<std::mutex> lock(live_mutex);
+                for (const SlabThreads::Registration& r : regs) {
+                    if (is_live(r.epoch)) { r.retire(r.owner, r.cache, r.id); }
+                }
+                regs.clear();
+            }
+            SlabThreads::t_exit = SlabThreads::Retired;
+        }
+    };
 
-    return cache->pop(size_class);
+    thread_local ThreadState t_state;
 }
 
-void slab::free(void* ptr) noexcept {
-    if (!ptr) {std::cerr << "bad free ptr"; return;}
+std::size_t SlabThreads::open() noexcept {
+    const std::size_t epoch = global_epoch.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(live_mutex);
+    live_epochs.push_back(epoch);
+    return epoch;
+}
 
-    BlockHeader* header = header_from_user_ptr(ptr);
-    const ThreadId owner = header->owner_id;
-    const SizeClassId size_class = header->size_id;
+void SlabThreads::close(std::size_t epoch) noexcept {
+    std::lock_guard<std::mutex> lock(live_mutex);
+    std::erase(live_epochs, epoch);
+}
 
-    if (t_cache && owner == t_id) {
-        t_cache->push(size_class, ptr); return;
+const SlabThreads::Registration* SlabThreads::find(std::size_t epoch) noexcept {
+    for (const Registration& r : t_state.regs) {
+        if (r.epoch == epoch) { return &r; }
     }
+    return nullptr;
+}
 
-    //remote free
-    ThreadCache* owner_cache = nullptr;
+void SlabThreads::add(const Registration& reg) noexcept {
     {
-        std::lock_guard<std::mutex> lock(registry_mutex);
-        if (owner < registry.size()) {
-            owner_cache = registry[owner].get();
-        }
+        std::lock_guard<std::mutex> lock(live_mutex);
+        std::erase_if(t_state.regs, [](const Registration& r) { return !is_live(r.epoch); });
     }
+    t_state.regs.push_back(reg);
+}
 
-    if (!owner_cache) {return;}
-    owner_cache->push_remote(ptr);
+void SlabThreads::lock() noexcept {
+    live_mutex.lock();
 }
+
+void SlabThreads::unlock() noexcept {
+    live_mutex.unlock();
+}
+
+template class basic_slab<default_config>;
+template class basic_slab<per_cpu_config>;
@@ -0,0 +1,3 @@
+#include "../include/slab_resource.h"
+
+template class slab_resource<slab>;
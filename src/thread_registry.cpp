@@ -0,0 +1,3 @@
+#include "../include/thread_registry.h"
+
+template class ThreadRegistry<default_config>;
@@ -0,0 +1,3 @@
+#include "../include/transfer_cache.h"
+
+template class TransferCache<default_config>;
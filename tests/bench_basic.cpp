@@ -1,4 +1,5 @@
 #include "../include/slab.h"
+#include "../include/object_pool.h"
 #include "bench_util.h"
 #include <cassert>
 #include <chrono>
@@ -9,8 +10,30 @@
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters, std::vector<uint64_t>& samples) {
-    slab allocator;
+// Page pool lock acquisitions and resident growth with every block allocated, and once
+// they are all freed again.
+struct PoolUse {
+    std::uint64_t live_locks = 0;
+    std::size_t rss_live = 0;
+    std::uint64_t locks = 0;
+    std::size_t rss_kept = 0;
+};
+
+static std::size_t growth(std::size_t base) {
+    const std::size_t now = rss_bytes();
+    return now > base ? now - base : 0;
+}
+
+// A policy with the old fixed refills: 128 blocks of every class, no adaptation.
+struct fixed_refill_config : default_config {
+    static constexpr std::uint32_t refill_batch(std::size_t) noexcept { return 128; }
+    static constexpr bool adaptive_refill = false;
+};
+
+template <class Slab = slab>
+static std::chrono::nanoseconds run_slab(std::size_t iters, std::vector<uint64_t>& samples, PoolUse& use) {
+    const std::size_t rss_base = rss_bytes();
+    Slab allocator;
     std::vector<void*> ptrs;
     ptrs.reserve(iters);
     std::mt19937 rng{12345};
@@ -34,10 +57,14 @@ static std::chrono::nanoseconds run_slab(std::size_t iters, std::vector<uint64_t
         auto t1 = clock_type::now();
         samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
     }
+    use.rss_live = growth(rss_base);
+    use.live_locks = allocator.pool_lock_count();
     for (void* p : ptrs) {
         allocator.free(p);
     }
     auto end = clock_type::now();
+    use.rss_kept = growth(rss_base);
+    use.locks = allocator.pool_lock_count();
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 }
 
@@ -72,6 +99,43 @@ static std::chrono::nanoseconds run_malloc(std::size_t iters, std::vector<uint64
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 }
 
+// Codegen probes for one 64-byte allocation, runtime lookup vs compile-time class:
+//   objdump -d --no-show-raw-insn -C out/bench_basic | grep -A24 '<probe_.*alloc'
+extern "C" [[gnu::noinline]] void* probe_runtime_alloc(slab& allocator, std::size_t size) {
+    return allocator.alloc(size, 1);
+}
+extern "C" [[gnu::noinline]] void* probe_fixed_alloc(slab& allocator) {
+    return allocator.alloc<64>();
+}
+extern "C" [[gnu::noinline]] void probe_fixed_free(slab& allocator, void* ptr) {
+    allocator.free<64>(ptr);
+}
+
+struct Message {
+    std::uint64_t seq;
+    std::uint32_t kind;
+    char payload[52];
+};
+
+// ns per alloc+free pair of one fixed type, `live` objects in flight.
+template <class Alloc, class Free>
+static double fixed_pair_ns(std::size_t iters, Alloc&& alloc, Free&& release) {
+    constexpr std::size_t live = 64;
+    std::vector<void*> ring(live);
+    for (void*& p : ring) { p = alloc(); }
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < iters; ++i) {
+        void*& slot = ring[i % live];
+        release(slot);
+        slot = alloc();
+        assert(slot != nullptr);
+    }
+    auto end = clock_type::now();
+    for (void* p : ring) { release(p); }
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())
+         / static_cast<double>(iters);
+}
+
 int main() {
     constexpr std::size_t iters = 100000;
     std::vector<uint64_t> slab_samples;
@@ -79,10 +143,48 @@ int main() {
     std::vector<uint64_t> malloc_samples;
     malloc_samples.reserve(iters);
 
-    auto t_slab = run_slab(iters, slab_samples);
+    PoolUse slab_use;
+    PoolUse fixed_use;
+    run_slab(iters, slab_samples, slab_use); // the process's first slab runs cold; not timed
+    slab_samples.clear();
+    auto t_slab = run_slab(iters, slab_samples, slab_use);
+    slab_samples.clear();
+    auto t_fixed = run_slab<basic_slab<fixed_refill_config>>(iters, slab_samples, fixed_use);
     auto t_malloc = run_malloc(iters, malloc_samples);
 
     std::cout << "basic iters=" << iters << "\n";
     print_latency_report("slab", t_slab, (iters * 1e9 / t_slab.count()), slab_samples);
+    print_latency_report("slab(fixed 128-block refills)", t_fixed, (iters * 1e9 / t_fixed.count()), slab_samples);
     print_latency_report("malloc", t_malloc, (iters * 1e9 / t_malloc.count()), malloc_samples);
+    print_pool_report("slab, all live", slab_use.live_locks, slab_use.rss_live);
+    print_pool_report("slab, all freed", slab_use.locks, slab_use.rss_kept);
+    print_pool_report("slab(fixed 128-block refills), all live", fixed_use.live_locks, fixed_use.rss_live);
+    print_pool_report("slab(fixed 128-block refills), all freed", fixed_use.locks, fixed_use.rss_kept);
+
+    // one fixed type: the size passed at runtime vs resolved at compile time
+    constexpr std::size_t pairs = 20000000;
+    slab fixed;
+    volatile std::size_t size = sizeof(Message); // keep the runtime path honest
+    const double runtime_ns = fixed_pair_ns(pairs,
+        [&] { return fixed.alloc(size, alignof(Message)); }, [&](void* p) { fixed.free(p); });
+    const double sized_ns = fixed_pair_ns(pairs,
+        [&] { return fixed.alloc(size, alignof(Message)); },
+        [&](void* p) { fixed.free(p, sizeof(Message), alignof(Message)); });
+    const double template_ns = fixed_pair_ns(pairs,
+        [&] { return fixed.alloc<sizeof(Message), alignof(Message)>(); },
+        [&](void* p) { fixed.free<sizeof(Message), alignof(Message)>(p); });
+    object_pool<Message> messages(fixed);
+    const double pool_ns = fixed_pair_ns(pairs,
+        [&] { return static_cast<void*>(messages.create()); },
+        [&](void* p) { messages.destroy(static_cast<Message*>(p)); });
+    const double malloc_ns = fixed_pair_ns(pairs,
+        [&] { return std::malloc(size); }, [](void* p) { std::free(p); });
+    std::cout << "fixed " << sizeof(Message) << "B pairs=" << pairs << " (ns per alloc+free)\n"
+              << "slab(runtime): " << runtime_ns << "\n"
+              << "slab(runtime, sized free): " << sized_ns << "\n"
+              << "slab(alloc<Size, Align>): " << template_ns << "\n"
+              << "object_pool: " << pool_ns << "\n"
+              << "malloc: " << malloc_ns << "\n";
+    probe_fixed_free(fixed, probe_fixed_alloc(fixed));
+    fixed.free(probe_runtime_alloc(fixed, size));
 }
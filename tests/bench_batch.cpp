@@ -0,0 +1,100 @@
+#include "../include/slab.h"
+#include "bench_util.h"
+#include <array>
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// Bursts of `burst` messages allocated and freed on one thread.
+template <class AllocBurst, class FreeBurst>
+static std::chrono::nanoseconds run_local(std::size_t rounds, std::size_t burst,
+        AllocBurst&& alloc_burst, FreeBurst&& free_burst) {
+    std::vector<void*> ptrs(burst);
+    alloc_burst(ptrs.data(), burst); // warm
+    free_burst(ptrs.data(), burst);
+    auto start = clock_type::now();
+    for (std::size_t r = 0; r < rounds; ++r) {
+        alloc_burst(ptrs.data(), burst);
+        free_burst(ptrs.data(), burst);
+    }
+    auto end = clock_type::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
+// A producer allocates bursts that a consumer thread frees.
+template <class AllocBurst, class FreeBurst>
+static std::chrono::nanoseconds run_remote(std::size_t rounds, std::size_t burst,
+        AllocBurst&& alloc_burst, FreeBurst&& free_burst) {
+    std::vector<void*> ptrs(burst);
+    std::barrier sync(2);
+    auto start = clock_type::now();
+    std::thread consumer([&] {
+        for (std::size_t r = 0; r < rounds; ++r) {
+            sync.arrive_and_wait();
+            free_burst(ptrs.data(), burst);
+            sync.arrive_and_wait();
+        }
+    });
+    for (std::size_t r = 0; r < rounds; ++r) {
+        alloc_burst(ptrs.data(), burst);
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+    }
+    consumer.join();
+    auto end = clock_type::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
+int main() {
+    constexpr std::size_t messages = 2000000;
+    constexpr std::size_t size = 256;
+    const std::array<std::size_t, 3> bursts{32, 128, 256};
+    std::vector<uint64_t> unused;
+
+    std::cout << "batch messages=" << messages << " size=" << size << "\n";
+    for (std::size_t burst : bursts) {
+        const std::size_t rounds = messages / burst;
+        const double ops = static_cast<double>(rounds * burst) * 2.0; // alloc + free
+        std::cout << "burst " << burst << "\n";
+
+        slab loop_alloc;
+        auto loop_alloc_burst = [&](void** out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) { out[i] = loop_alloc.alloc(size, 1); assert(out[i]); }
+        };
+        auto loop_free_burst = [&](void** ptrs, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) { loop_alloc.free(ptrs[i]); }
+        };
+        slab batch_alloc;
+        auto batch_alloc_burst = [&](void** out, std::size_t n) {
+            [[maybe_unused]] const std::size_t made = batch_alloc.alloc_batch(size, 1, n, out);
+            assert(made == n);
+        };
+        auto batch_free_burst = [&](void** ptrs, std::size_t n) { batch_alloc.free_batch(ptrs, n); };
+        auto malloc_burst = [&](void** out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) { out[i] = std::malloc(size); assert(out[i]); }
+        };
+        auto free_burst = [&](void** ptrs, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) { std::free(ptrs[i]); }
+        };
+
+        auto t_loop = run_local(rounds, burst, loop_alloc_burst, loop_free_burst);
+        auto t_batch = run_local(rounds, burst, batch_alloc_burst, batch_free_burst);
+        auto t_malloc = run_local(rounds, burst, malloc_burst, free_burst);
+        print_latency_report("slab(loop)", t_loop, (ops * 1e9 / t_loop.count()), unused);
+        print_latency_report("slab(batch)", t_batch, (ops * 1e9 / t_batch.count()), unused);
+        print_latency_report("malloc", t_malloc, (ops * 1e9 / t_malloc.count()), unused);
+
+        auto r_loop = run_remote(rounds, burst, loop_alloc_burst, loop_free_burst);
+        auto r_batch = run_remote(rounds, burst, batch_alloc_burst, batch_free_burst);
+        auto r_malloc = run_remote(rounds, burst, malloc_burst, free_burst);
+        print_latency_report("slab(loop, remote)", r_loop, (ops * 1e9 / r_loop.count()), unused);
+        print_latency_report("slab(batch, remote)", r_batch, (ops * 1e9 / r_batch.count()), unused);
+        print_latency_report("malloc(remote)", r_malloc, (ops * 1e9 / r_malloc.count()), unused);
+    }
+}
@@ -12,10 +12,26 @@
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
-    slab allocator;
-    constexpr int threads = 4;
+// A policy with the old fixed refills: 128 blocks of every class, no adaptation.
+struct fixed_refill_config : default_config {
+    static constexpr std::uint32_t refill_batch(std::size_t) noexcept { return 128; }
+    static constexpr bool adaptive_refill = false;
+};
+
+// Pool lock acquisitions and resident growth, with the workers done but still alive
+// (holding their thread caches) and once they exited.
+struct PoolUse {
+    std::uint64_t locks = 0;
+    std::size_t rss_held = 0;
+    std::size_t rss_kept = 0;
+};
+
+template <class Slab = slab>
+static std::chrono::nanoseconds run_slab(std::uint16_t threads, std::size_t iters_per_thread, std::vector<uint64_t>& samples, PoolUse& use) {
+    const std::size_t rss_base = rss_bytes();
+    Slab allocator;
     std::barrier sync(threads);
+    std::barrier held(threads + 1);
     std::vector<std::thread> workers;
     workers.reserve(threads);
     std::vector<std::vector<uint64_t>> thread_samples(threads);
@@ -63,18 +79,26 @@ static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vect
             for (void* p : bag) {
                 allocator.free(p);
             }
+            held.arrive_and_wait();
+            held.arrive_and_wait();
         });
     }
-    for (auto& th : workers) th.join();
+    held.arrive_and_wait();
     auto end = clock_type::now();
+    const std::size_t rss_held = rss_bytes();
+    held.arrive_and_wait();
+    for (auto& th : workers) th.join();
     for (auto& v : thread_samples) {
         samples.insert(samples.end(), v.begin(), v.end());
     }
+    const std::size_t rss_now = rss_bytes();
+    use.rss_held = rss_held > rss_base ? rss_held - rss_base : 0;
+    use.rss_kept = rss_now > rss_base ? rss_now - rss_base : 0;
+    use.locks = allocator.pool_lock_count();
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 }
 
-static std::chrono::nanoseconds run_malloc(std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
-    constexpr int threads = 4;
+static std::chrono::nanoseconds run_malloc(std::uint16_t threads, std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
     std::barrier sync(threads);
     std::vector<std::thread> workers;
     workers.reserve(threads);
@@ -126,16 +150,33 @@ static std::chrono::nanoseconds run_malloc(std::size_t iters_per_thread, std::ve
 
 int main() {
     constexpr std::size_t iters_per_thread = 100000;
-    const double total_ops = static_cast<double>(iters_per_thread) * 4.0;
-    std::vector<uint64_t> slab_samples;
-    slab_samples.reserve(static_cast<std::size_t>(total_ops));
-    std::vector<uint64_t> malloc_samples;
-    malloc_samples.reserve(static_cast<std::size_t>(total_ops));
+    // 4 threads, then oversubscribed: several threads per core
+    const auto oversubscribed = static_cast<std::uint16_t>(std::max(16u, 4 * std::thread::hardware_concurrency()));
+    for (std::uint16_t threads : {std::uint16_t{4}, oversubscribed}) {
+        const double total_ops = static_cast<double>(iters_per_thread) * threads;
+        std::vector<uint64_t> slab_samples;
+        slab_samples.reserve(static_cast<std::size_t>(total_ops));
+        std::vector<uint64_t> malloc_samples;
+        malloc_samples.reserve(static_cast<std::size_t>(total_ops));
 
-    auto t_slab = run_slab(iters_per_thread, slab_samples);
-    auto t_malloc = run_malloc(iters_per_thread, malloc_samples);
+        PoolUse slab_use;
+        PoolUse fixed_use;
+        PoolUse cpu_use;
+        auto t_slab = run_slab(threads, iters_per_thread, slab_samples, slab_use);
+        slab_samples.clear();
+        auto t_fixed = run_slab<basic_slab<fixed_refill_config>>(threads, iters_per_thread, slab_samples, fixed_use);
+        slab_samples.clear();
+        auto t_cpu = run_slab<basic_slab<per_cpu_config>>(threads, iters_per_thread, slab_samples, cpu_use);
+        auto t_malloc = run_malloc(threads, iters_per_thread, malloc_samples);
 
-    std::cout << "four_thread iters/thread=" << iters_per_thread << "\n";
-    print_latency_report("slab", t_slab, (total_ops * 1e9 / t_slab.count()), slab_samples);
-    print_latency_report("malloc", t_malloc, (total_ops * 1e9 / t_malloc.count()), malloc_samples);
+        std::cout << "four_thread threads=" << threads << " iters/thread=" << iters_per_thread << "\n";
+        print_latency_report("slab", t_slab, (total_ops * 1e9 / t_slab.count()), slab_samples);
+        print_latency_report("slab(fixed 128-block refills)", t_fixed, (total_ops * 1e9 / t_fixed.count()), slab_samples);
+        print_latency_report("slab(per-cpu)", t_cpu, (total_ops * 1e9 / t_cpu.count()), slab_samples);
+        print_latency_report("malloc", t_malloc, (total_ops * 1e9 / t_malloc.count()), malloc_samples);
+        print_pool_report("slab, workers alive", slab_use.locks, slab_use.rss_held);
+        print_pool_report("slab, workers exited", slab_use.locks, slab_use.rss_kept);
+        print_pool_report("slab(fixed 128-block refills), workers exited", fixed_use.locks, fixed_use.rss_kept);
+        print_pool_report("slab(per-cpu), workers alive", cpu_use.locks, cpu_use.rss_held);
+    }
 }
@@ -0,0 +1,56 @@
+#include "../include/slab.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// Bytes of page per object with the old layout: a 4-byte header before every block,
+// the block aligned after it, and the stride rounded up to the alignment.
+static double header_layout_bytes(std::size_t size, std::size_t align) {
+    auto align_up = [](std::size_t x, std::size_t a) { return (x + (a - 1)) & ~(a - 1); };
+    const std::size_t stride = align_up(align_up(4, align) + size, align);
+    const std::size_t blocks = (page_size - span_header_bytes) / stride;
+    return static_cast<double>(page_size) / static_cast<double>(blocks);
+}
+
+static double span_layout_bytes(std::size_t size, std::size_t align) {
+    SizeClassId cls = 0;
+    while (sizes[cls] < size || class_align(sizes[cls]) < align) { ++cls; }
+    return static_cast<double>(page_size) / static_cast<double>(class_layout[cls].count);
+}
+
+// Average ns per local free of touched blocks, freed in a scattered order.
+static double free_ns(std::size_t size, std::size_t align, std::size_t iters) {
+    slab allocator;
+    std::vector<void*> ptrs(iters);
+    for (std::size_t i = 0; i < iters; ++i) {
+        ptrs[i] = allocator.alloc(static_cast<SizeClassId>(size), align);
+        assert(ptrs[i] != nullptr);
+        *static_cast<volatile char*>(ptrs[i]) = 1; // fault pages in before timing
+    }
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < iters; ++i) { allocator.free(ptrs[(i * 7919) % iters]); }
+    auto end = clock_type::now();
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count())
+         / static_cast<double>(iters);
+}
+
+int main() {
+    constexpr std::size_t iters = 20000;
+    const std::array<std::size_t, 3> aligns{1, 16, 64};
+
+    std::cout << "layout iters=" << iters << " (bytes/object: header layout -> span layout)\n";
+    for (SizeClassId size : sizes) {
+        for (std::size_t align : aligns) {
+            std::cout << "size " << size << " align " << align << ": "
+                      << header_layout_bytes(size, align) << " -> " << span_layout_bytes(size, align)
+                      << " B/object, free " << free_ns(size, align, iters) << " ns/op\n";
+        }
+    }
+}
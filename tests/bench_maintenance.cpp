@@ -0,0 +1,86 @@
+#include "../include/slab.h"
+#include "bench_util.h"
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+// A request thread: bursts of message allocations with idle gaps between them. The live
+// set grows by a quarter of each burst, so refills keep reaching the page pool and fresh
+// pages, and every few rounds it is dropped, emptying pages. Every alloc and free is timed.
+template <class Alloc, class Free>
+static void run_requests(std::size_t rounds, std::vector<uint64_t>& samples, Alloc&& alloc, Free&& free) {
+    constexpr std::array<std::size_t, 4> sizes{64, 256, 1024, 4096};
+    constexpr std::size_t burst = 32;
+    constexpr std::size_t keep = burst / 4;
+    std::mt19937 rng(25);
+    std::deque<void*> live;
+    auto timed = [&](auto&& op) {
+        const auto t0 = clock_type::now();
+        op();
+        const auto t1 = clock_type::now();
+        samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+    };
+    for (std::size_t round = 0; round < rounds; ++round) {
+        for (std::size_t i = 0; i < burst; ++i) {
+            const std::size_t size = sizes[rng() % sizes.size()];
+            void* p = nullptr;
+            timed([&] { p = alloc(size); });
+            static_cast<volatile char*>(p)[0] = 1;
+            live.push_back(p);
+        }
+        const std::size_t drop = (round % 512 == 511) ? live.size() : burst - keep;
+        for (std::size_t i = 0; i < drop; ++i) {
+            void* p = live.front();
+            live.pop_front();
+            timed([&] { free(p); });
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50)); // idle between requests
+    }
+    for (void* p : live) { free(p); }
+}
+
+static void run_slab(std::size_t rounds, std::vector<uint64_t>& samples, const MaintenanceOptions* options) {
+    slab allocator;
+    if (options && !allocator.start_maintenance(*options)) { std::cerr << "maintenance thread failed\n"; }
+    std::thread worker([&] {
+        run_requests(rounds, samples,
+            [&](std::size_t size) { return allocator.alloc(size, 1); },
+            [&](void* p) { allocator.free(p); });
+    });
+    worker.join();
+    if (options) {
+        const MaintenanceStats stats = allocator.maintenance_stats();
+        std::cout << "maintenance: " << stats.passes << " passes, " << stats.batches_built << " batches built, "
+                  << stats.pages_prefaulted << " pages prefaulted, " << stats.batches_scavenged
+                  << " batches scavenged, " << stats.pages_released << " pages released\n";
+    }
+}
+
+int main() {
+    constexpr std::size_t rounds = 4096;
+    std::vector<uint64_t> inline_samples;
+    std::vector<uint64_t> maintained;
+    std::vector<uint64_t> malloc_samples;
+
+    MaintenanceOptions options;
+    options.period = std::chrono::microseconds(200);
+    run_slab(rounds, inline_samples, nullptr);
+    run_slab(rounds, maintained, &options);
+    std::thread worker([&] {
+        run_requests(rounds, malloc_samples,
+            [](std::size_t size) { return std::malloc(size); },
+            [](void* p) { std::free(p); });
+    });
+    worker.join();
+
+    std::cout << "maintenance rounds=" << rounds << " (allocs and frees of request bursts)\n";
+    print_tail_report("slab(inline refills)", inline_samples);
+    print_tail_report("slab(maintenance thread)", maintained);
+    print_tail_report("malloc", malloc_samples);
+}
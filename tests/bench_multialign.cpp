@@ -12,13 +12,13 @@
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
+template <class Slab = slab>
+static std::chrono::nanoseconds run_slab(std::uint16_t threads, std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
     const std::array<std::size_t, 3> aligns{1, 16, 64};
-    const int threads = static_cast<int>(aligns.size());
     std::barrier sync(threads);
     std::vector<std::thread> workers;
     workers.reserve(threads);
-    slab allocator;
+    Slab allocator;
     std::vector<std::vector<uint64_t>> thread_samples(threads);
     auto warm = [&]() {
         std::mt19937 rng{555};
@@ -36,7 +36,7 @@ static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vect
     auto start = clock_type::now();
     for (int idx = 0; idx < threads; ++idx) {
         workers.emplace_back([&, idx] {
-            const std::size_t align = aligns[idx];
+            const std::size_t align = aligns[idx % aligns.size()];
             std::mt19937 rng(static_cast<unsigned>(idx + 21));
             std::uniform_int_distribution<int> dist(0, static_cast<int>(NumClasses - 1));
             std::vector<void*> bag;
@@ -70,9 +70,8 @@ static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vect
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 }
 
-static std::chrono::nanoseconds run_malloc(std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
+static std::chrono::nanoseconds run_malloc(std::uint16_t threads, std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
     const std::array<std::size_t, 3> aligns{1, 16, 64};
-    const int threads = static_cast<int>(aligns.size());
     std::barrier sync(threads);
     std::vector<std::thread> workers;
     workers.reserve(threads);
@@ -98,7 +97,7 @@ static std::chrono::nanoseconds run_malloc(std::size_t iters_per_thread, std::ve
     auto start = clock_type::now();
     for (int idx = 0; idx < threads; ++idx) {
         workers.emplace_back([&, idx] {
-            const std::size_t align = aligns[idx];
+            const std::size_t align = aligns[idx % aligns.size()];
             std::mt19937 rng(static_cast<unsigned>(idx + 31));
             std::uniform_int_distribution<int> dist(0, static_cast<int>(NumClasses - 1));
             std::vector<void*> bag;
@@ -139,15 +138,22 @@ static std::chrono::nanoseconds run_malloc(std::size_t iters_per_thread, std::ve
 
 int main() {
     constexpr std::size_t iters_per_thread = 100000;
-    const double total_ops = static_cast<double>(iters_per_thread) * 3.0;
-    std::vector<uint64_t> slab_samples;
-    slab_samples.reserve(static_cast<std::size_t>(total_ops));
-    std::vector<uint64_t> malloc_samples;
-    malloc_samples.reserve(static_cast<std::size_t>(total_ops));
-    auto t_slab = run_slab(iters_per_thread, slab_samples);
-    auto t_malloc = run_malloc(iters_per_thread, malloc_samples);
+    // one thread per alignment, then oversubscribed: several threads per core
+    const auto oversubscribed = static_cast<std::uint16_t>(std::max(15u, 4 * std::thread::hardware_concurrency()));
+    for (std::uint16_t threads : {std::uint16_t{3}, oversubscribed}) {
+        const double total_ops = static_cast<double>(iters_per_thread) * threads;
+        std::vector<uint64_t> slab_samples;
+        slab_samples.reserve(static_cast<std::size_t>(total_ops));
+        std::vector<uint64_t> malloc_samples;
+        malloc_samples.reserve(static_cast<std::size_t>(total_ops));
+        auto t_slab = run_slab(threads, iters_per_thread, slab_samples);
+        slab_samples.clear();
+        auto t_cpu = run_slab<basic_slab<per_cpu_config>>(threads, iters_per_thread, slab_samples);
+        auto t_malloc = run_malloc(threads, iters_per_thread, malloc_samples);
 
-    std::cout << "multialign iters/thread=" << iters_per_thread << "\n";
-    print_latency_report("slab", t_slab, (total_ops * 1e9 / t_slab.count()), slab_samples);
-    print_latency_report("malloc", t_malloc, (total_ops * 1e9 / t_malloc.count()), malloc_samples);
+        std::cout << "multialign threads=" << threads << " iters/thread=" << iters_per_thread << "\n";
+        print_latency_report("slab", t_slab, (total_ops * 1e9 / t_slab.count()), slab_samples);
+        print_latency_report("slab(per-cpu)", t_cpu, (total_ops * 1e9 / t_cpu.count()), slab_samples);
+        print_latency_report("malloc", t_malloc, (total_ops * 1e9 / t_malloc.count()), malloc_samples);
+    }
 }
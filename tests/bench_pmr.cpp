@@ -0,0 +1,121 @@
+#include "../include/slab.h"
+#include "../include/slab_resource.h"
+#include "bench_util.h"
+#include <barrier>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+
+static volatile std::size_t sink;
+
+// Node churn on one container: a list and a hash map filled to `live` nodes, then
+// `rounds` of erasing and re-inserting random keys. Every step allocates or frees a node.
+template <class List, class Map>
+static void churn(List& nodes, Map& map, std::size_t live, std::size_t rounds, unsigned seed) {
+    std::mt19937 rng{seed};
+    for (std::size_t i = 0; i < live; ++i) {
+        nodes.push_back(static_cast<int>(i));
+        map.emplace(static_cast<int>(i), static_cast<int>(i));
+    }
+    for (std::size_t r = 0; r < rounds; ++r) {
+        const int key = static_cast<int>(rng() % (2 * live));
+        if (!map.erase(key)) { map.emplace(key, key); }
+        nodes.pop_front();
+        nodes.push_back(key);
+    }
+    sink = nodes.size() + map.size();
+}
+
+// One thread per container set (`make` returns a pointer to something with `nodes` and
+// `map`); the container types carry the allocator under test.
+template <class Make>
+static std::chrono::nanoseconds run(std::uint16_t threads, std::size_t live, std::size_t rounds, Make&& make) {
+    std::barrier sync(threads + 1);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            auto set = make();
+            sync.arrive_and_wait();
+            churn(set->nodes, set->map, live, rounds, static_cast<unsigned>(t + 1));
+            sync.arrive_and_wait();
+        });
+    }
+    sync.arrive_and_wait();
+    auto start = clock_type::now();
+    sync.arrive_and_wait();
+    auto end = clock_type::now();
+    for (auto& w : workers) { w.join(); }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
+template <class List, class Map>
+struct Containers {
+    List nodes;
+    Map map;
+};
+
+// unsynchronized pools cannot be shared, so each thread owns one
+struct OwnedPool {
+    std::pmr::unsynchronized_pool_resource pool;
+    std::pmr::list<int> nodes{&pool};
+    std::pmr::unordered_map<int, int> map{&pool};
+};
+
+using PmrList = std::pmr::list<int>;
+using PmrMap = std::pmr::unordered_map<int, int>;
+using SlabList = std::list<int, slab_allocator<int>>;
+using SlabMap = std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                                   slab_allocator<std::pair<const int, int>>>;
+
+int main() {
+    constexpr std::size_t live = 10000;
+    constexpr std::size_t rounds = 500000;
+    std::vector<uint64_t> unused;
+
+    std::cout << "pmr live=" << live << " rounds=" << rounds << " (list + unordered_map nodes)\n";
+    for (int threads : {1, 4}) {
+        // ~3 allocations or frees per round (map node, list pop, list push), plus the fill
+        const double ops = static_cast<double>(threads) * static_cast<double>(rounds * 3 + live * 2);
+        std::cout << "threads " << threads << "\n";
+
+        using PmrSet = Containers<PmrList, PmrMap>;
+        slab resource_slab;
+        slab_resource slab_res(resource_slab);
+        auto t_resource = run(threads, live, rounds, [&] {
+            return std::make_unique<PmrSet>(PmrList(&slab_res), PmrMap(&slab_res));
+        });
+
+        slab allocator_slab;
+        auto t_allocator = run(threads, live, rounds, [&] {
+            return std::make_unique<Containers<SlabList, SlabMap>>(SlabList(slab_allocator<int>(allocator_slab)),
+                SlabMap(0, std::hash<int>{}, std::equal_to<int>{}, slab_allocator<std::pair<const int, int>>(allocator_slab)));
+        });
+
+        auto t_unsync = run(threads, live, rounds, [] { return std::make_unique<OwnedPool>(); });
+
+        std::pmr::synchronized_pool_resource sync_pool;
+        auto t_sync = run(threads, live, rounds, [&] {
+            return std::make_unique<PmrSet>(PmrList(&sync_pool), PmrMap(&sync_pool));
+        });
+
+        auto t_new = run(threads, live, rounds, [] {
+            return std::make_unique<PmrSet>(PmrList(std::pmr::new_delete_resource()),
+                                            PmrMap(std::pmr::new_delete_resource()));
+        });
+
+        print_latency_report("slab_resource", t_resource, (ops * 1e9 / t_resource.count()), unused);
+        print_latency_report("slab_allocator", t_allocator, (ops * 1e9 / t_allocator.count()), unused);
+        print_latency_report("unsynchronized_pool(per thread)", t_unsync, (ops * 1e9 / t_unsync.count()), unused);
+        print_latency_report("synchronized_pool", t_sync, (ops * 1e9 / t_sync.count()), unused);
+        print_latency_report("new_delete", t_new, (ops * 1e9 / t_new.count()), unused);
+    }
+}
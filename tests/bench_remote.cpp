@@ -12,8 +12,8 @@
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters, std::vector<uint64_t>& samples) {
-    slab allocator;
+static std::chrono::nanoseconds run_slab(std::size_t iters, std::vector<uint64_t>& samples, RemoteFreeMode mode) {
+    slab allocator(mode);
     std::vector<void*> shared(iters);
     std::barrier sync(2);
     std::mt19937 rng{123};
@@ -140,13 +140,17 @@ int main() {
     constexpr std::size_t iters = 100000;
     std::vector<uint64_t> slab_samples;
     slab_samples.reserve(iters * 2);
+    std::vector<uint64_t> adopt_samples;
+    adopt_samples.reserve(iters * 2);
     std::vector<uint64_t> malloc_samples;
     malloc_samples.reserve(iters * 2);
 
-    auto t_slab = run_slab(iters, slab_samples);
+    auto t_slab = run_slab(iters, slab_samples, RemoteFreeMode::Return);
+    auto t_adopt = run_slab(iters, adopt_samples, RemoteFreeMode::Adopt);
     auto t_malloc = run_malloc(iters, malloc_samples);
 
     std::cout << "remote iters=" << iters << "\n";
     print_latency_report("slab", t_slab, (iters * 1e9 / t_slab.count()), slab_samples);
+    print_latency_report("slab(adopt)", t_adopt, (iters * 1e9 / t_adopt.count()), adopt_samples);
     print_latency_report("malloc", t_malloc, (iters * 1e9 / t_malloc.count()), malloc_samples);
 }
@@ -12,8 +12,8 @@
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vector<uint64_t>& samples) {
-    slab allocator;
+static std::chrono::nanoseconds run_slab(std::size_t iters_per_thread, std::vector<uint64_t>& samples, RemoteFreeMode mode) {
+    slab allocator(mode);
     constexpr int threads = 6;
     const int owner_idx = 0;
     std::barrier sync(threads);
@@ -133,12 +133,16 @@ int main() {
     const double producer_ops = static_cast<double>(iters_per_thread) * 5.0;
     std::vector<uint64_t> slab_samples;
     slab_samples.reserve(static_cast<std::size_t>(producer_ops * 2));
+    std::vector<uint64_t> adopt_samples;
+    adopt_samples.reserve(static_cast<std::size_t>(producer_ops * 2));
     std::vector<uint64_t> malloc_samples;
     malloc_samples.reserve(static_cast<std::size_t>(producer_ops * 2));
-    auto t_slab = run_slab(iters_per_thread, slab_samples);
+    auto t_slab = run_slab(iters_per_thread, slab_samples, RemoteFreeMode::Return);
+    auto t_adopt = run_slab(iters_per_thread, adopt_samples, RemoteFreeMode::Adopt);
     auto t_malloc = run_malloc(iters_per_thread, malloc_samples);
 
     std::cout << "remote_many_to_one iters/producer=" << iters_per_thread << "\n";
     print_latency_report("slab", t_slab, (producer_ops * 1e9 / t_slab.count()), slab_samples);
+    print_latency_report("slab(adopt)", t_adopt, (producer_ops * 1e9 / t_adopt.count()), adopt_samples);
     print_latency_report("malloc", t_malloc, (producer_ops * 1e9 / t_malloc.count()), malloc_samples);
 }
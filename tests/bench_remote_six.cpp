@@ -1,19 +1,21 @@
 #include "../include/slab.h"
 #include "bench_util.h"
 #include <array>
+#include <atomic>
 #include <barrier>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <limits>
 #include <random>
 #include <thread>
 #include <vector>
 
 using clock_type = std::chrono::steady_clock;
 
-static std::chrono::nanoseconds run_slab(std::size_t iters_per_pair, std::vector<uint64_t>& samples) {
-    slab allocator;
+static std::chrono::nanoseconds run_slab(std::size_t iters_per_pair, std::vector<uint64_t>& samples, RemoteFreeMode mode) {
+    slab allocator(mode);
     constexpr int threads = 6;
     constexpr int pairs = threads / 2;
     std::barrier sync(threads);
@@ -157,17 +159,149 @@ static std::chrono::nanoseconds run_malloc(std::size_t iters_per_pair, std::vect
     return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
 }
 
+// The policy without return rings: every remote free goes through the owner's inbox.
+struct no_ring_config : default_config {
+    static constexpr std::uint32_t return_rings = 0;
+};
+
+// Streaming pairs: each consumer frees its producer's blocks while the producer keeps
+// allocating (handed over through a published index), so owners take returned blocks
+// back mid-run. `pair` sees the consumer's first block before it is freed.
+template <class Alloc, class Free, class Pair>
+static std::chrono::nanoseconds run_stream(std::size_t iters_per_pair, Alloc&& alloc, Free&& release, Pair&& pair) {
+    constexpr std::uint16_t pairs = 3;
+    std::barrier sync(pairs * 2 + 1);
+    std::array<std::vector<void*>, pairs> shared{};
+    std::array<std::atomic<std::size_t>, pairs> published{};
+    for (auto& v : shared) { v.resize(iters_per_pair, nullptr); }
+    const std::array<std::size_t, 3> aligns{1, 16, 64};
+    std::vector<std::thread> workers;
+    for (int p = 0; p < pairs; ++p) {
+        workers.emplace_back([&, p] {
+            std::mt19937 rng(static_cast<unsigned>(p + 501));
+            std::uniform_int_distribution<int> size_dist(0, static_cast<int>(NumClasses - 1));
+            std::uniform_int_distribution<int> align_dist(0, 2);
+            sync.arrive_and_wait();
+            for (std::size_t i = 0; i < iters_per_pair; ++i) {
+                SizeClassId cls = static_cast<SizeClassId>(size_dist(rng));
+                shared[p][i] = alloc(sizes[cls], aligns[align_dist(rng)]);
+                assert(shared[p][i] != nullptr);
+                published[p].store(i + 1, std::memory_order_release);
+            }
+            sync.arrive_and_wait();
+        });
+        workers.emplace_back([&, p] {
+            sync.arrive_and_wait();
+            for (std::size_t i = 0; i < iters_per_pair; ++i) {
+                while (published[p].load(std::memory_order_acquire) <= i) { std::this_thread::yield(); }
+                if (i == 0) { pair(shared[p][0]); }
+                release(shared[p][i]);
+            }
+            sync.arrive_and_wait();
+        });
+    }
+    sync.arrive_and_wait();
+    auto start = clock_type::now();
+    sync.arrive_and_wait();
+    auto end = clock_type::now();
+    for (auto& th : workers) th.join();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
+// The old draining: a miss walks everything returned, and frees never look at the inbox.
+struct drain_all_config : default_config {
+    static constexpr std::uint32_t drain_step = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint32_t drain_miss_steps = 1;
+    static constexpr std::uint32_t drain_interval = std::numeric_limits<std::uint32_t>::max();
+};
+
+// One pair: the consumer hands a whole burst back, then the owner goes on with mixed-class
+// alloc/free and records each allocation; the burst waits in its inbox and rings.
+template <class Slab>
+static void run_burst(std::size_t burst, std::size_t ops, std::vector<uint64_t>& samples) {
+    Slab allocator;
+    std::vector<void*> blocks(burst);
+    std::mt19937 rng(601);
+    std::uniform_int_distribution<int> size_dist(0, static_cast<int>(NumClasses - 1));
+    std::thread owner([&] {
+        for (auto& p : blocks) { p = allocator.alloc(sizes[size_dist(rng)], 1); }
+        std::thread consumer([&] {
+            for (void* p : blocks) { allocator.free(p); }
+            allocator.flush();
+        });
+        consumer.join();
+        std::vector<void*> live;
+        for (std::size_t i = 0; i < ops; ++i) {
+            const SizeClassId cls = static_cast<SizeClassId>(size_dist(rng));
+            auto t0 = clock_type::now();
+            live.push_back(allocator.alloc(sizes[cls], 1));
+            auto t1 = clock_type::now();
+            samples.push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+            if (live.size() > 64) {
+                const std::size_t k = rng() % live.size();
+                allocator.free(live[k]);
+                live[k] = live.back();
+                live.pop_back();
+            }
+        }
+        for (void* p : live) { allocator.free(p); }
+    });
+    owner.join();
+}
+
+template <class Slab>
+static std::chrono::nanoseconds run_slab_stream(std::size_t iters_per_pair, bool paired) {
+    Slab allocator;
+    return run_stream(iters_per_pair,
+        [&](std::size_t size, std::size_t align) { return allocator.alloc(size, align); },
+        [&](void* p) { allocator.free(p); },
+        [&](void* p) { if (paired) { allocator.pair_with(p); } });
+}
+
+static void* malloc_aligned(std::size_t size, std::size_t align) {
+    void* p = nullptr;
+    if (align <= alignof(std::max_align_t)) { return std::malloc(size); }
+    return posix_memalign(&p, align, size) == 0 ? p : nullptr;
+}
+
 int main() {
     constexpr std::size_t iters_per_pair = 100000;
     const double total_ops = static_cast<double>(iters_per_pair) * 3.0; // producers only
     std::vector<uint64_t> slab_samples;
     slab_samples.reserve(static_cast<std::size_t>(total_ops * 2)); // include frees
+    std::vector<uint64_t> adopt_samples;
+    adopt_samples.reserve(static_cast<std::size_t>(total_ops * 2));
     std::vector<uint64_t> malloc_samples;
     malloc_samples.reserve(static_cast<std::size_t>(total_ops * 2));
-    auto t_slab = run_slab(iters_per_pair, slab_samples);
+    auto t_slab = run_slab(iters_per_pair, slab_samples, RemoteFreeMode::Return);
+    auto t_adopt = run_slab(iters_per_pair, adopt_samples, RemoteFreeMode::Adopt);
     auto t_malloc = run_malloc(iters_per_pair, malloc_samples);
 
     std::cout << "remote_six iters/pair=" << iters_per_pair << "\n";
     print_latency_report("slab", t_slab, (total_ops * 1e9 / t_slab.count()), slab_samples);
+    print_latency_report("slab(adopt)", t_adopt, (total_ops * 1e9 / t_adopt.count()), adopt_samples);
     print_latency_report("malloc", t_malloc, (total_ops * 1e9 / t_malloc.count()), malloc_samples);
+
+    // streaming: frees overlap the owners' allocations
+    run_slab_stream<slab>(iters_per_pair, false); // untimed warm-up, the first slab of a process runs cold
+    auto s_rings = run_slab_stream<slab>(iters_per_pair, false);
+    auto s_paired = run_slab_stream<slab>(iters_per_pair, true);
+    auto s_inbox = run_slab_stream<basic_slab<no_ring_config>>(iters_per_pair, false);
+    auto s_malloc = run_stream(iters_per_pair, malloc_aligned, [](void* p) { std::free(p); }, [](void*) {});
+    std::vector<uint64_t> unused;
+    std::cout << "remote_six streaming iters/pair=" << iters_per_pair << "\n";
+    print_latency_report("slab(rings)", s_rings, (total_ops * 1e9 / s_rings.count()), unused);
+    print_latency_report("slab(pair_with)", s_paired, (total_ops * 1e9 / s_paired.count()), unused);
+    print_latency_report("slab(inbox only)", s_inbox, (total_ops * 1e9 / s_inbox.count()), unused);
+    print_latency_report("malloc", s_malloc, (total_ops * 1e9 / s_malloc.count()), unused);
+
+    // tail latency of an owner whose pair just returned a burst of iters_per_pair blocks
+    constexpr std::size_t burst_ops = 200000;
+    std::vector<uint64_t> stepped;
+    std::vector<uint64_t> drain_all;
+    run_burst<slab>(iters_per_pair, burst_ops, stepped);
+    run_burst<basic_slab<drain_all_config>>(iters_per_pair, burst_ops, drain_all);
+    std::cout << "remote_six burst=" << iters_per_pair << " then " << burst_ops << " owner allocs\n";
+    print_tail_report("slab(drain steps)", stepped);
+    print_tail_report("slab(drain all)", drain_all);
 }
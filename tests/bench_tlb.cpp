@@ -0,0 +1,114 @@
+#include "../include/slab.h"
+#include "bench_util.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using clock_type = std::chrono::steady_clock;
+
+// dTLB load misses of this thread; reads -1 when perf events are unavailable.
+struct TlbCounter {
+    int fd = -1;
+
+    TlbCounter() {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~TlbCounter() { if (fd >= 0) { ::close(fd); } }
+
+    void start() { if (fd >= 0) { ::ioctl(fd, PERF_EVENT_IOC_RESET, 0); ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0); } }
+    long long stop() {
+        if (fd < 0) { return -1; }
+        ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (::read(fd, &count, sizeof(count)) != sizeof(count)) { return -1; }
+        return count;
+    }
+};
+
+static volatile std::uint64_t sink;
+
+// Churns many small objects, then touches them in random order so page walks dominate.
+template <class Alloc, class Free>
+static std::chrono::nanoseconds churn(std::size_t objects, long long& misses, Alloc&& alloc, Free&& release) {
+    std::vector<void*> ptrs(objects);
+    std::mt19937 rng{4242};
+    std::uniform_int_distribution<int> dist(0, 4); // 16..256 bytes
+    std::vector<std::size_t> order(objects);
+    for (std::size_t i = 0; i < objects; ++i) { order[i] = i; }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    TlbCounter counter;
+    counter.start();
+    auto start = clock_type::now();
+    for (std::size_t i = 0; i < objects; ++i) {
+        SizeClassId cls = static_cast<SizeClassId>(dist(rng));
+        ptrs[i] = alloc(sizes[cls]);
+        assert(ptrs[i] != nullptr);
+        std::memset(ptrs[i], 1, sizes[0]);
+    }
+    std::uint64_t sum = 0;
+    for (int pass = 0; pass < 4; ++pass) {
+        for (std::size_t idx : order) { sum += *static_cast<volatile unsigned char*>(ptrs[idx]); }
+    }
+    for (std::size_t idx : order) { release(ptrs[idx]); }
+    auto end = clock_type::now();
+    misses = counter.stop();
+    sink = sum;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+}
+
+static std::chrono::nanoseconds run_slab(std::size_t objects, long long& misses, PageBacking backing) {
+    slab allocator(RemoteFreeMode::Return, backing);
+    return churn(objects, misses,
+        [&](std::size_t size) { return allocator.alloc(static_cast<SizeClassId>(size), 1); },
+        [&](void* p) { allocator.free(p); });
+}
+
+static std::chrono::nanoseconds run_malloc(std::size_t objects, long long& misses) {
+    return churn(objects, misses,
+        [](std::size_t size) { return std::malloc(size); },
+        [](void* p) { std::free(p); });
+}
+
+static void print_misses(long long misses) {
+    if (misses < 0) { std::cout << "  dTLB-load-misses: n/a (perf events unavailable)\n"; return; }
+    std::cout << "  dTLB-load-misses: " << misses << "\n";
+}
+
+int main() {
+    constexpr std::size_t objects = 2000000;
+    const double ops = static_cast<double>(objects) * 2.0; // alloc + free
+    std::vector<uint64_t> unused;
+    long long per_page_misses = 0;
+    long long huge_misses = 0;
+    long long malloc_misses = 0;
+
+    auto t_per_page = run_slab(objects, per_page_misses, PageBacking::PerPage);
+    auto t_huge = run_slab(objects, huge_misses, PageBacking::HugeArena);
+    auto t_malloc = run_malloc(objects, malloc_misses);
+
+    std::cout << "tlb objects=" << objects << "\n";
+    print_latency_report("slab(per_page)", t_per_page, (ops * 1e9 / t_per_page.count()), unused);
+    print_misses(per_page_misses);
+    print_latency_report("slab(huge_arena)", t_huge, (ops * 1e9 / t_huge.count()), unused);
+    print_misses(huge_misses);
+    print_latency_report("malloc", t_malloc, (ops * 1e9 / t_malloc.count()), unused);
+    print_misses(malloc_misses);
+}
@@ -1,8 +1,11 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <vector>
+#include <unistd.h>
 
 inline double to_us(std::chrono::nanoseconds ns) {
     return std::chrono::duration<double, std::micro>(ns).count();
@@ -15,3 +18,29 @@ inline void print_latency_report(const char* label, std::chrono::nanoseconds tot
               << ops_per_sec << " ops/sec"
               << "\n";
 }
+
+// Resident bytes of the process now (/proc/self/statm), 0 if unreadable.
+inline std::size_t rss_bytes() {
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) { return 0; }
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    const int got = std::fscanf(f, "%lu %lu", &size, &resident);
+    std::fclose(f);
+    return got == 2 ? resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE)) : 0;
+}
+
+// Page pool lock acquisitions and resident growth of one run.
+inline void print_pool_report(const char* label, std::uint64_t pool_locks, std::size_t rss_growth) {
+    std::cout << label << ": " << pool_locks << " pool locks, rss +"
+              << static_cast<double>(rss_growth) / (1024.0 * 1024.0) << " MB\n";
+}
+
+// Percentiles and worst case of per-operation latencies (sorts samples).
+inline void print_tail_report(const char* label, std::vector<uint64_t>& samples_ns) {
+    if (samples_ns.empty()) { return; }
+    std::sort(samples_ns.begin(), samples_ns.end());
+    auto at = [&](double q) { return samples_ns[static_cast<std::size_t>(q * static_cast<double>(samples_ns.size() - 1))]; };
+    std::cout << label << ": p50 " << at(0.5) << " ns, p99 " << at(0.99) << " ns, p99.9 " << at(0.999)
+              << " ns, max " << samples_ns.back() << " ns\n";
+}
@@ -1,18 +1,47 @@
 #include "../include/slab.h"
+#include "../include/slab_resource.h"
+#include "../include/object_pool.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <barrier>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <list>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <random>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 struct TestCase {
     const char* name;
     void (*fn)();
 };
 
+// This process's resident set, from /proc/self/statm; 0 if it cannot be read.
+static std::size_t resident_bytes() {
+    unsigned long size = 0;
+    unsigned long resident = 0;
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+        if (std::fscanf(f, "%lu %lu", &size, &resident) != 2) { resident = 0; }
+        std::fclose(f);
+    }
+    return resident * static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
 static void test_basic() {
     slab allocator;
     for (SizeClassId sz : sizes) {
@@ -38,6 +67,28 @@ static void test_alignment_single_thread() {
         assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
         allocator.free(p);
     }
+
+    // blocks freed after unaligned requests must not come back misaligned
+    std::vector<void*> loose;
+    for (SizeClassId sz : sizes) {
+        for (int i = 0; i < 64; ++i) { loose.push_back(allocator.alloc(sz, 1)); }
+    }
+    for (void* p : loose) { allocator.free(p); }
+    for (std::size_t align : {std::size_t{16}, std::size_t{32}, std::size_t{64}}) {
+        for (SizeClassId sz : sizes) {
+            void* p = allocator.alloc(sz, align);
+            assert(p != nullptr);
+            assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+            allocator.free(p);
+        }
+    }
+
+    // an aligned class serves both kinds of request from the same thread-local list
+    void* loose_block = allocator.alloc(64, 1);
+    allocator.free(loose_block);
+    void* aligned_block = allocator.alloc(64, 64);
+    assert(aligned_block == loose_block);
+    allocator.free(aligned_block);
 }
 
 static void test_remote_free_two_threads() {
@@ -141,13 +192,1181 @@ static void test_multithread_alignment() {
     }
 }
 
-int main() {
-    const std::array<TestCase, 5> tests{{
+static void test_remote_free_many_owners() {
+    slab allocator;
+    constexpr int threads = 8;
+    constexpr int count = 512;
+    std::vector<std::vector<void*>> owned(threads);
+    std::barrier sync(threads + 1);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            sync.arrive_and_wait();
+            for (int i = 0; i < count; ++i) {
+                void* p = allocator.alloc(sizes[i % NumClasses], 1);
+                assert(p != nullptr);
+                owned[t].push_back(p);
+            }
+            sync.arrive_and_wait();
+            sync.arrive_and_wait();
+
+            // every block came back to its owner and is served again
+            assert(allocator.maintain() == count);
+            std::vector<void*> again;
+            for (int i = 0; i < count; ++i) { again.push_back(allocator.alloc(sizes[i % NumClasses], 1)); }
+            std::vector<void*> mine = owned[t];
+            std::sort(mine.begin(), mine.end());
+            for (void* p : again) { assert(std::binary_search(mine.begin(), mine.end(), p)); }
+            for (void* p : again) { allocator.free(p); }
+        });
+    }
+
+    // main thread registers last and frees every other thread's blocks remotely
+    sync.arrive_and_wait();
+    sync.arrive_and_wait();
+    void* mine = allocator.alloc(64, 1);
+    assert(mine != nullptr);
+    for (auto& v : owned) {
+        for (void* p : v) { allocator.free(p); }
+    }
+    allocator.free(mine);
+    allocator.flush();
+    sync.arrive_and_wait();
+
+    for (auto& th : workers) {
+        th.join();
+    }
+}
+
+static void test_remote_free_batched_flush() {
+    slab allocator;
+    std::vector<void*> owned;
+    const std::uint32_t first_refill = default_traits::refill_floor[default_traits::get_bucket(64, 1)];
+    for (std::uint32_t i = 0; i < first_refill; ++i) { // exactly one refill, cache left empty
+        owned.push_back(allocator.alloc(64, 1));
+        assert(owned.back() != nullptr);
+    }
+
+    // fewer than remote_batch frees stay buffered until the freer flushes (the freer stays
+    // alive throughout, since its exit would flush them too)
+    constexpr int freed = 5;
+    std::barrier sync(2);
+    std::thread consumer([&] {
+        for (int i = 0; i < freed; ++i) { allocator.free(owned[i]); }
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+        allocator.flush();
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+    });
+    sync.arrive_and_wait();
+    assert(allocator.maintain() == 0);
+    sync.arrive_and_wait();
+    sync.arrive_and_wait();
+
+    void* again = allocator.alloc(64, 1);
+    assert(std::find(owned.begin(), owned.begin() + freed, again) != owned.begin() + freed);
+    allocator.free(again);
+    for (std::uint32_t i = freed; i < first_refill; ++i) { allocator.free(owned[i]); }
+    sync.arrive_and_wait();
+    consumer.join();
+}
+
+// Tiny return rings opened after one remote batch, so frees overflow them back into the inbox.
+struct small_ring_config : default_config {
+    static constexpr std::uint32_t return_ring_slots = 16;
+    static constexpr std::uint32_t return_ring_after = 1;
+};
+
+static void test_return_rings() {
+    // a paired freer's blocks reach the owner without a flush, unlike the buffered path; the
+    // consumer stays alive across the owner's allocations, as its exit would flush them
+    auto returned_unflushed = [](bool paired) {
+        slab allocator;
+        std::vector<void*> owned;
+        const std::uint32_t first_refill = default_traits::refill_floor[default_traits::get_bucket(64, 1)];
+        for (std::uint32_t i = 0; i < first_refill; ++i) {
+            owned.push_back(allocator.alloc(64, 1));
+            assert(owned.back() != nullptr);
+        }
+        assert(!allocator.pair_with(owned[0])); // own block
+        constexpr int freed = 5;
+        std::barrier sync(2);
+        std::thread consumer([&] {
+            if (paired) { assert(allocator.pair_with(owned[0])); }
+            for (int i = 0; i < freed; ++i) { allocator.free(owned[i]); }
+            sync.arrive_and_wait(); // freed
+            sync.arrive_and_wait(); // owner done
+        });
+        sync.arrive_and_wait();
+
+        std::vector<void*> again;
+        int back = 0;
+        for (int i = 0; i < freed; ++i) {
+            again.push_back(allocator.alloc(64, 1));
+            if (std::find(owned.begin(), owned.begin() + freed, again.back()) != owned.begin() + freed) { ++back; }
+        }
+        sync.arrive_and_wait();
+        consumer.join();
+        for (void* p : again) { allocator.free(p); }
+        for (std::uint32_t i = freed; i < first_refill; ++i) { allocator.free(owned[i]); }
+        return back;
+    };
+    assert(returned_unflushed(true) > 0);
+    assert(returned_unflushed(false) == 0);
+
+    // detected pair: chain, ring, ring full and back to the inbox; every block comes home once
+    {
+        basic_slab<small_ring_config> allocator;
+        constexpr std::size_t count = 200;
+        std::vector<void*> owned;
+        for (std::size_t i = 0; i < count; ++i) { owned.push_back(allocator.alloc(64, 1)); }
+        std::thread consumer([&] {
+            for (void* p : owned) { allocator.free(p); }
+            allocator.flush();
+        });
+        consumer.join();
+
+        std::vector<void*> held;
+        std::size_t back = 0;
+        while (back < count && held.size() < 100 * count) {
+            held.push_back(allocator.alloc(64, 1));
+            if (std::find(owned.begin(), owned.end(), held.back()) != owned.end()) { ++back; }
+        }
+        assert(back == count);
+        std::vector<void*> sorted = held;
+        std::sort(sorted.begin(), sorted.end());
+        assert(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+        for (void* p : held) { allocator.free(p); }
+    }
+
+    // streaming pairs: owners allocate while their consumers free, so rings drain mid-flight;
+    // a block handed out twice would clobber its tag before the consumer reads it
+    {
+        basic_slab<small_ring_config> allocator;
+        constexpr int pairs = 2;
+        constexpr std::size_t count = 20000;
+        std::array<std::vector<std::uint64_t*>, pairs> handoff;
+        std::array<std::atomic<std::size_t>, pairs> published{};
+        std::vector<std::thread> workers;
+        for (int p = 0; p < pairs; ++p) {
+            handoff[p].resize(count);
+            workers.emplace_back([&, p] {
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto* block = static_cast<std::uint64_t*>(allocator.alloc(16 + 16 * (i % 8), 1));
+                    assert(block != nullptr);
+                    *block = i;
+                    handoff[p][i] = block;
+                    published[p].store(i + 1, std::memory_order_release);
+                }
+            });
+            workers.emplace_back([&, p] {
+                for (std::size_t i = 0; i < count; ++i) {
+                    while (published[p].load(std::memory_order_acquire) <= i) { std::this_thread::yield(); }
+                    assert(*handoff[p][i] == i);
+                    allocator.free(handoff[p][i]);
+                }
+            });
+        }
+        for (auto& w : workers) { w.join(); }
+    }
+}
+
+static void test_remote_draining_is_incremental() {
+    slab allocator;
+    constexpr std::uint32_t count = 2000;
+    constexpr std::uint32_t step = default_config::drain_step;
+    std::vector<void*> owned;
+    for (std::uint32_t i = 0; i < count; ++i) { owned.push_back(allocator.alloc(64, 1)); }
+    std::thread consumer([&] {
+        for (void* p : owned) { allocator.free(p); }
+        allocator.flush();
+    });
+    consumer.join();
+
+    // a miss on another class drains a bounded number of steps, not the whole inbox
+    void* other = allocator.alloc(48, 1);
+    std::uint32_t taken = default_config::drain_miss_steps * step;
+
+    // a thread that never misses still drains a step every drain_interval frees
+    for (std::uint32_t i = 0; i < 4 * default_config::drain_interval; ++i) {
+        allocator.free(other);
+        other = allocator.alloc(48, 1);
+    }
+    taken += 4 * step;
+    assert(allocator.maintain() == count - taken);
+    assert(allocator.maintain() == 0);
+
+    // everything came home: the blocks are served again before fresh ones
+    std::vector<void*> again;
+    for (std::uint32_t i = 0; i < count; ++i) { again.push_back(allocator.alloc(64, 1)); }
+    std::sort(owned.begin(), owned.end());
+    std::size_t reused = 0;
+    for (void* p : again) { reused += std::binary_search(owned.begin(), owned.end(), p) ? 1 : 0; }
+    assert(reused == count);
+    for (void* p : again) { allocator.free(p); }
+    allocator.free(other);
+}
+
+static void test_frees_to_exited_owner() {
+    slab allocator;
+    constexpr int count = 100;
+    constexpr int buffered = 5; // fewer than remote_batch
+    std::vector<void*> owned;
+    std::barrier sync(2);
+    std::thread owner([&] {
+        for (int i = 0; i < count; ++i) { owned.push_back(allocator.alloc(64, 1)); }
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+    });
+    std::thread freer([&] {
+        sync.arrive_and_wait();
+        for (int i = 0; i < buffered; ++i) { allocator.free(owned[i]); }
+        sync.arrive_and_wait();
+        owner.join();
+
+        // the chain buffered for the exited owner comes back to this cache at the flush
+        allocator.flush();
+        assert(allocator.maintain() == buffered);
+        // and later frees of its blocks stay here, served again by the next allocations
+        for (int i = buffered; i < count; ++i) { allocator.free(owned[i]); }
+        assert(allocator.maintain() == 0);
+        std::vector<void*> again;
+        for (int i = 0; i < count; ++i) { again.push_back(allocator.alloc(64, 1)); }
+        std::sort(owned.begin(), owned.end());
+        for (void* p : again) { assert(std::binary_search(owned.begin(), owned.end(), p)); }
+        for (void* p : again) { allocator.free(p); }
+    });
+    freer.join();
+}
+
+// A thread-local whose destructor allocates after the slab's thread-exit hook has run.
+struct AllocAtExit {
+    slab* allocator = nullptr;
+    bool* ok = nullptr;
+    ~AllocAtExit() {
+        if (!allocator) { return; }
+        void* small = allocator->alloc(64, 1);
+        void* large = allocator->alloc(100 * 1000, 1);
+        std::array<void*, 8> burst{};
+        const std::size_t made = allocator->alloc_batch(128, 1, burst.size(), burst.data());
+        *ok = slab::thread_retired() && small && large && made == burst.size();
+        allocator->free(small);
+        allocator->free(large);
+        allocator->free_batch(burst.data(), made);
+    }
+};
+
+static void test_alloc_after_thread_exit() {
+    slab allocator;
+    bool ok = false;
+    std::thread([&] {
+        static thread_local AllocAtExit late;
+        late.allocator = &allocator;
+        late.ok = &ok;
+        allocator.free(allocator.alloc(64, 1)); // registers after late exists, so its hook runs first
+    }).join();
+    assert(ok);
+}
+
+static void test_adopt_mode_keeps_remote_blocks() {
+    // the producer stays alive until the consumer is done, so its blocks have a live owner
+    // to go back to; whether the consumer's next allocation reuses one depends on the mode
+    auto reuses_remote_block = [](RemoteFreeMode mode) {
+        slab allocator(mode);
+        constexpr int count = 10;
+        std::vector<void*> produced;
+        std::barrier sync(2);
+        std::thread producer([&] {
+            for (int i = 0; i < count; ++i) {
+                produced.push_back(allocator.alloc(64, 1));
+                assert(produced.back() != nullptr);
+            }
+            sync.arrive_and_wait(); // produced
+            sync.arrive_and_wait(); // consumer done
+        });
+        sync.arrive_and_wait();
+        for (void* p : produced) { allocator.free(p); }
+        void* next = allocator.alloc(64, 1);
+        const bool reused = std::find(produced.begin(), produced.end(), next) != produced.end();
+        allocator.free(next);
+        sync.arrive_and_wait();
+        producer.join();
+        return reused;
+    };
+    // the consumer's cache was empty, so in adopt mode its next allocation reuses an adopted
+    // block; in return mode the blocks head back to the producer and it refills elsewhere
+    assert(reuses_remote_block(RemoteFreeMode::Adopt));
+    assert(!reuses_remote_block(RemoteFreeMode::Return));
+}
+
+static void test_thread_exit_recycles_blocks_and_ids() {
+    slab allocator;
+    std::vector<void*> first;
+    std::thread a([&] {
+        for (std::uint32_t i = 0; i < default_traits::batch[default_traits::get_bucket(64, 1)]; ++i) {
+            first.push_back(allocator.alloc(64, 1));
+            assert(first.back() != nullptr);
+        }
+        for (void* p : first) { allocator.free(p); }
+    });
+    a.join();
+
+    // a later thread takes over the exited thread's id and its cached blocks
+    for (int round = 0; round < 32; ++round) {
+        std::thread b([&] {
+            void* p = allocator.alloc(64, 1);
+            assert(p != nullptr);
+            assert(owner_of(p) == 0);
+            assert(std::find(first.begin(), first.end(), p) != first.end());
+            allocator.free(p);
+        });
+        b.join();
+    }
+}
+
+static void test_transfer_cache_moves_batches() {
+    slab allocator;
+    std::vector<void*> freed;
+    std::barrier sync(2);
+    const SizeClassId cls = default_traits::get_bucket(128, 1);
+
+    std::thread a([&] { // frees past its largest cache limit while staying alive
+        for (std::uint32_t i = 0; i < default_traits::cache_max_length[cls] + 2 * default_traits::batch[cls]; ++i) {
+            freed.push_back(allocator.alloc(128, 1));
+            assert(freed.back() != nullptr);
+        }
+        for (void* p : freed) { allocator.free(p); }
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+    });
+
+    std::thread b([&] {
+        sync.arrive_and_wait();
+        void* p = allocator.alloc(128, 1);
+        assert(std::find(freed.begin(), freed.end(), p) != freed.end());
+        allocator.free(p);
+        sync.arrive_and_wait();
+    });
+
+    a.join();
+    b.join();
+}
+
+static void test_thread_cache_limits_adapt() {
+    constexpr std::uint32_t batch = default_traits::batch[0];
+    constexpr std::uint32_t max_length = default_traits::cache_max_length[0];
+    auto cache = std::make_unique<ThreadCache<>>();
+    std::vector<FreeNode> nodes(max_length + 1);
+    std::size_t used = 0;
+
+    while (used <= batch) { cache->push(0, &nodes[used++]); }
+    assert(cache->over_limit(0));
+
+    // slow start up to the ceiling, never past it
+    for (int miss = 0; miss < 64; ++miss) { cache->on_miss(0, default_config::max_thread_cache_bytes); }
+    while (used < max_length) { cache->push(0, &nodes[used++]); }
+    assert(!cache->over_limit(0));
+    cache->push(0, &nodes[used++]);
+    assert(cache->over_limit(0));
+    assert(cache->count(0) == max_length + 1);
+
+    // repeated overflows decay the limit by one batch
+    for (int i = 0; i < cache_overflow_decay; ++i) { cache->on_overflow(0); }
+    FreeNode* popped = cache->pop_batch(0, batch);
+    assert(popped != nullptr);
+    assert(cache->over_limit(0));
+    assert(cache->pop(0) != nullptr);
+    assert(!cache->over_limit(0));
+
+    // a budget already spent blocks growth
+    cache->reset_limits();
+    cache->on_miss(NumClasses - 1, default_config::min_thread_cache_bytes);
+    while (cache->count(NumClasses - 1) <= default_traits::batch[NumClasses - 1]) { cache->push(NumClasses - 1, &nodes[--used]); }
+    assert(cache->over_limit(NumClasses - 1));
+}
+
+// A policy with the old fixed refills: 128 blocks of every class, no adaptation.
+struct fixed_refill_config : default_config {
+    static constexpr std::uint32_t refill_batch(std::size_t) noexcept { return 128; }
+    static constexpr bool adaptive_refill = false;
+};
+
+static void test_refill_sizes_adapt() {
+    // batches are a byte budget per class; fixed policies refill whole batches
+    static_assert(default_traits::batch[0] == 1024 && default_traits::batch[NumClasses - 1] == 8);
+    static_assert(default_traits::refill_floor[0] == 128 && default_traits::refill_floor[NumClasses - 1] == 1);
+    static_assert(config_traits<fixed_refill_config>::refill_floor == config_traits<fixed_refill_config>::batch);
+
+    const SizeClassId cls = default_traits::get_bucket(64, 1);
+    const std::uint32_t floor = default_traits::refill_floor[cls];
+    const std::uint32_t batch = default_traits::batch[cls];
+    auto cache = std::make_unique<ThreadCache<>>();
+    assert(cache->refill_count(cls) == floor);
+
+    // the first miss refills the floor, each quick miss after it doubles up to a batch
+    cache->on_miss(cls, default_config::max_thread_cache_bytes);
+    assert(cache->refill_count(cls) == floor);
+    for (std::uint32_t expect = floor * 2; expect <= batch; expect *= 2) {
+        cache->on_miss(cls, default_config::max_thread_cache_bytes);
+        assert(cache->refill_count(cls) == expect);
+    }
+    cache->on_miss(cls, default_config::max_thread_cache_bytes);
+    assert(cache->refill_count(cls) == batch);
+
+    // idle through other classes' misses: halves on its next miss
+    for (std::uint32_t i = 0; i <= default_config::refill_idle_misses; ++i) {
+        cache->on_miss(0, default_config::max_thread_cache_bytes);
+    }
+    assert(cache->refill_count(0) == default_traits::batch[0]);
+    cache->on_miss(cls, default_config::max_thread_cache_bytes);
+    assert(cache->refill_count(cls) == batch / 2);
+
+    // overflow decay halves too, down to the floor
+    for (int round = 0; round < 8; ++round) {
+        for (int i = 0; i < cache_overflow_decay; ++i) { cache->on_overflow(cls); }
+    }
+    assert(cache->refill_count(cls) == floor);
+    cache->reset_limits();
+    assert(cache->refill_count(0) == default_traits::refill_floor[0]);
+
+    // a thread working through one class takes fewer pool trips than its blocks / floor
+    slab allocator;
+    std::vector<void*> ptrs;
+    const std::uint64_t before = allocator.pool_lock_count();
+    for (std::uint32_t i = 0; i < 8 * batch; ++i) {
+        ptrs.push_back(allocator.alloc(64, 1));
+        assert(ptrs.back() != nullptr);
+    }
+    const std::uint64_t trips = allocator.pool_lock_count() - before;
+    assert(trips >= 1 && trips < 8 * batch / floor);
+    for (void* p : ptrs) { allocator.free(p); }
+
+    basic_slab<fixed_refill_config> fixed;
+    void* p = fixed.alloc(64, 1);
+    assert(p != nullptr && fixed.pool_lock_count() == 1);
+    fixed.free(p);
+}
+
+static void test_concurrent_refills_distinct_blocks() {
+    slab allocator;
+    constexpr int threads = 6;
+    constexpr int count = 1500;
+    std::vector<std::vector<void*>> got(threads);
+    std::barrier sync(threads);
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    // two threads per class hammer the same shard while others refill other shards
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            const SizeClassId size = sizes[NumClasses - 1 - t / 2];
+            sync.arrive_and_wait();
+            for (int i = 0; i < count; ++i) {
+                void* p = allocator.alloc(size, 1);
+                assert(p != nullptr);
+                got[t].push_back(p);
+            }
+        });
+    }
+    for (auto& th : workers) {
+        th.join();
+    }
+
+    std::vector<void*> all;
+    for (auto& v : got) { all.insert(all.end(), v.begin(), v.end()); }
+    std::sort(all.begin(), all.end());
+    assert(std::adjacent_find(all.begin(), all.end()) == all.end());
+    for (void* p : all) { allocator.free(p); }
+}
+
+static void test_trim_releases_empty_pages() {
+    slab allocator;
+    allocator.set_page_retention(std::numeric_limits<std::size_t>::max());
+    std::vector<void*> ptrs;
+    constexpr std::uint32_t blocks = 1024;
+    for (std::uint32_t i = 0; i < blocks; ++i) {
+        ptrs.push_back(allocator.alloc(4096, 1));
+        assert(ptrs.back() != nullptr);
+    }
+    for (void* p : ptrs) { allocator.free(p); }
+
+    // everything came back, so all but the page still being carved can go
+    const std::size_t released = allocator.trim();
+    assert(released >= (blocks / (page_size / 4096) - 2) * page_size);
+    assert(allocator.trim() == 0);
+
+    // released pages are reused, by any class
+    for (void*& p : ptrs) {
+        p = allocator.alloc(64, 64);
+        assert(p != nullptr);
+        assert(reinterpret_cast<std::uintptr_t>(p) % 64 == 0);
+        std::memset(p, 0xab, 64);
+    }
+    for (void* p : ptrs) { allocator.free(p); }
+}
+
+static void test_background_maintenance() {
+    using namespace std::chrono_literals;
+    slab allocator;
+    allocator.set_page_retention(2);
+    MaintenanceOptions options;
+    options.cpu = sched_getcpu(); // a CPU this process may run on, whatever its affinity mask
+    options.period = 200us;
+    options.prefault_pages = 2;
+    options.idle_passes = 50;
+    options.max_release_pages = 4;
+    assert(allocator.start_maintenance(options));
+    assert(!allocator.start_maintenance(options));
+    // polls the thread's stats for up to five seconds
+    auto eventually = [&](auto done) {
+        for (int i = 0; i < 5000 && !done(allocator.maintenance_stats()); ++i) { std::this_thread::sleep_for(1ms); }
+        return done(allocator.maintenance_stats());
+    };
+    assert(eventually([](const MaintenanceStats& s) { return s.pages_prefaulted >= 2; }));
+
+    // a thread looking in the transfer cache has batches built for the next one
+    std::thread([&] { allocator.free(allocator.alloc(256, 1)); }).join();
+    assert(eventually([&](const MaintenanceStats& s) { return s.batches_built >= options.ready_batches; }));
+    allocator.stop_maintenance();
+    allocator.stop_maintenance();
+    assert(allocator.maintenance_stats().passes == 0);
+    std::thread([&] {
+        const std::uint64_t locks = allocator.pool_lock_count();
+        void* p = allocator.alloc(256, 1);
+        assert(p != nullptr && allocator.pool_lock_count() == locks);
+        allocator.free(p);
+    }).join();
+
+    // batches of a class nobody looks for go back to the pool
+    assert(allocator.start_maintenance(options));
+    assert(eventually([](const MaintenanceStats& s) { return s.batches_scavenged > 0; }));
+
+    // pages emptied by a departing thread go back to the OS from the maintenance thread,
+    // at most max_release_pages a pass
+    std::thread([&] {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 1024; ++i) { ptrs.push_back(allocator.alloc(4096, 1)); }
+        for (void* p : ptrs) { std::memset(p, 0xab, 4096); }
+        for (void* p : ptrs) { allocator.free(p); }
+    }).join();
+    assert(eventually([](const MaintenanceStats& s) { return s.pages_released >= 16; }));
+    // the destructor stops the thread
+}
+
+static void test_page_backings() {
+    for (PageBacking backing : {PageBacking::PerPage, PageBacking::Arena, PageBacking::HugeArena}) {
+        slab allocator(RemoteFreeMode::Return, backing);
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 4096; ++i) {
+            void* p = allocator.alloc(sizes[i % NumClasses], 16);
+            assert(p != nullptr);
+            assert(reinterpret_cast<std::uintptr_t>(p) % 16 == 0);
+            std::memset(p, 0xcd, sizes[i % NumClasses]);
+            ptrs.push_back(p);
+        }
+        for (void* p : ptrs) { allocator.free(p); }
+        allocator.trim();
+    }
+}
+
+static void test_blocks_packed_at_natural_alignment() {
+    slab allocator;
+    for (SizeClassId cls = 0; cls < NumClasses; ++cls) {
+        std::vector<void*> ptrs;
+        for (std::uint32_t i = 0; i < class_layout[cls].count; ++i) {
+            void* p = allocator.alloc(sizes[cls], 1);
+            assert(p != nullptr);
+            assert(reinterpret_cast<std::uintptr_t>(p) % class_align(sizes[cls]) == 0);
+            assert(span_of(p)->size_class == cls);
+            ptrs.push_back(p);
+        }
+        // a page worth of blocks fits on (at most) two pages, with no headers between blocks
+        std::vector<Span*> spans;
+        for (void* p : ptrs) {
+            const auto off = static_cast<std::size_t>(static_cast<std::byte*>(p) - reinterpret_cast<std::byte*>(span_of(p)));
+            assert(off >= class_layout[cls].first && (off - class_layout[cls].first) % sizes[cls] == 0);
+            spans.push_back(span_of(p));
+        }
+        std::sort(spans.begin(), spans.end());
+        assert(std::unique(spans.begin(), spans.end()) - spans.begin() <= 2);
+        for (void* p : ptrs) { allocator.free(p); }
+    }
+}
+
+static void test_size_class_lookup_is_tight() {
+    slab allocator;
+    for (std::size_t align : {std::size_t{1}, std::size_t{16}, std::size_t{64}}) {
+        for (std::size_t size = 1; size <= max_small_size; ++size) {
+            void* p = allocator.alloc(static_cast<SizeClassId>(size), align);
+            assert(p != nullptr);
+            assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+            const SizeClassId cls = span_of(p)->size_class;
+            assert(sizes[cls] >= size);
+            // no smaller class would have fit with this alignment
+            for (SizeClassId smaller = 0; smaller < cls; ++smaller) {
+                assert(sizes[smaller] < size || class_align(sizes[smaller]) < align);
+            }
+            allocator.free(p);
+        }
+    }
+    // past the table the large tier takes over
+    void* big = allocator.alloc(max_small_size + 1, 1);
+    assert(big != nullptr && span_of(big)->size_class == large_class);
+    allocator.free(big);
+    // 257-byte messages no longer round up to 512
+    void* p = allocator.alloc(257, 1);
+    assert(sizes[span_of(p)->size_class] < 512);
+    allocator.free(p);
+}
+
+static void test_power_of_two_alignments() {
+    slab allocator;
+    for (std::size_t align = 1; align <= page_size; align *= 2) {
+        std::vector<void*> ptrs;
+        for (std::size_t size : {std::size_t{1}, std::size_t{100}, std::size_t{700}, max_small_size}) {
+            for (int i = 0; i < 8; ++i) {
+                void* p = allocator.alloc(static_cast<SizeClassId>(size), align);
+                assert(p != nullptr);
+                assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+                // aligned classes are multiples of the alignment, so blocks carry no padding
+                const SizeClassId cls = span_of(p)->size_class;
+                assert(cls == large_class || sizes[cls] % std::max(align, class_small_step) == 0);
+                assert((cls == large_class) == (align > max_class_align));
+                std::memset(p, 0x5a, size);
+                ptrs.push_back(p);
+            }
+        }
+        for (void* p : ptrs) { allocator.free(p); }
+    }
+    assert(allocator.alloc(64, page_size * 2) == nullptr);
+}
+
+static void test_large_objects() {
+    slab allocator;
+    const std::array<std::size_t, 6> lengths{max_small_size + 1, 8 * 1024, 64 * 1024, 300 * 1000,
+                                             max_span_pages * page_size, 4 * 1024 * 1024};
+    for (std::size_t len : lengths) {
+        for (std::size_t align : {std::size_t{1}, std::size_t{4096}, page_size}) {
+            auto* p = static_cast<unsigned char*>(allocator.alloc(len, align));
+            assert(p != nullptr);
+            assert(reinterpret_cast<std::uintptr_t>(p) % align == 0);
+            assert(span_of(p)->size_class == large_class);
+            std::memset(p, 0xab, len);
+            assert(p[0] == 0xab && p[len - 1] == 0xab);
+            allocator.free(p);
+
+            // freed spans come straight back, from the thread cache or the mapping cache
+            void* again = allocator.alloc(len, align);
+            assert(again == p);
+            allocator.free(again);
+        }
+    }
+
+    // large blocks freed by another thread are reusable there
+    void* shared = allocator.alloc(100 * 1000, 1);
+    std::thread other([&] {
+        allocator.free(shared);
+        assert(allocator.alloc(100 * 1000, 1) == shared);
+    });
+    other.join();
+
+    // small and large blocks mix freely
+    std::vector<void*> ptrs;
+    for (int i = 0; i < 64; ++i) {
+        ptrs.push_back(allocator.alloc(static_cast<std::size_t>(i) * 1500 + 1, 16));
+    }
+    for (void* p : ptrs) { assert(p != nullptr); allocator.free(p); }
+    assert(allocator.trim() > 0);
+
+    // freed mappings stay cached within map_cache_bytes; a larger one is unmapped at once
+    void* cached = allocator.alloc(default_traits::map_cache_bytes / 4, 1);
+    std::memset(cached, 0xab, default_traits::map_cache_bytes / 4);
+    allocator.free(cached);
+    assert(allocator.trim() >= default_traits::map_cache_bytes / 4);
+    void* huge = allocator.alloc(default_traits::map_cache_bytes + 1, 1);
+    assert(huge != nullptr);
+    std::memset(huge, 0xab, default_traits::map_cache_bytes + 1);
+    allocator.free(huge);
+    assert(allocator.trim() == 0);
+
+    // sizes no span can hold fail instead of rounding around to a small class
+    constexpr std::size_t max = std::numeric_limits<std::size_t>::max();
+    for (std::size_t len : {max, max - 3, max - 14, max / 2}) {
+        assert(allocator.alloc(len, 1) == nullptr);
+        assert(allocator.alloc(len, 64) == nullptr);
+        assert(allocator.alloc_batch(len, 1, 1, ptrs.data()) == 0);
+    }
+}
+
+static void test_alloc_zeroed() {
+    slab allocator;
+    auto all_zero = [](const void* p, std::size_t len) {
+        const auto* bytes = static_cast<const unsigned char*>(p);
+        return std::all_of(bytes, bytes + len, [](unsigned char b) { return b == 0; });
+    };
+    // reused blocks, spans and mappings are cleared
+    for (std::size_t len : {std::size_t{100}, std::size_t{300 * 1000}, std::size_t{4 * 1024 * 1024}}) {
+        void* p = allocator.alloc(len, 1);
+        std::memset(p, 0xab, len);
+        allocator.free(p);
+        void* again = allocator.alloc_zeroed(len, 1);
+        assert(again == p && all_zero(again, len));
+        std::memset(again, 0xcd, len);
+        allocator.free(again);
+    }
+    // a fresh mapping is already zero and stays uncommitted until written
+    constexpr std::size_t len = 16 * 1024 * 1024;
+    const std::size_t before = resident_bytes();
+    void* fresh = allocator.alloc_zeroed(len, 1);
+    assert(fresh != nullptr);
+    assert(resident_bytes() < before + len / 4);
+    assert(all_zero(fresh, len));
+    allocator.free(fresh);
+}
+
+static void test_out_of_memory_returns_null() {
+    const pid_t pid = ::fork();
+    if (pid == 0) { // in a child, whose address space is capped a little above its use
+        slab allocator(RemoteFreeMode::Return, PageBacking::PerPage);
+        allocator.free(allocator.alloc(64, 1)); // registers before the cap
+        unsigned long mapped = 0;
+        if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+            if (std::fscanf(f, "%lu", &mapped) != 1) { mapped = 0; }
+            std::fclose(f);
+        }
+        const rlim_t cap = mapped * static_cast<rlim_t>(::sysconf(_SC_PAGESIZE)) + (64 << 20);
+        const rlimit limit{cap, cap};
+        if (mapped == 0 || ::setrlimit(RLIMIT_AS, &limit) != 0) { ::_exit(2); }
+
+        std::size_t got = 0;
+        while (allocator.alloc(4096, 1) != nullptr) { ++got; }
+        static std::array<void*, 4096> out;
+        const bool ok = got > 0 && allocator.alloc_batch(64, 1, out.size(), out.data()) < out.size()
+            && allocator.alloc(4096, 1) == nullptr && allocator.alloc(2 << 20, 1) == nullptr;
+        ::_exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+static void test_batch_alloc_free() {
+    slab allocator;
+    constexpr std::size_t burst = 200;
+    std::array<void*, burst> ptrs{};
+
+    // more than one refill's worth, aligned, distinct
+    assert(allocator.alloc_batch(96, 32, burst, ptrs.data()) == burst);
+    std::vector<void*> sorted(ptrs.begin(), ptrs.end());
+    std::sort(sorted.begin(), sorted.end());
+    assert(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+    for (void* p : ptrs) {
+        assert(reinterpret_cast<std::uintptr_t>(p) % 32 == 0);
+        std::memset(p, 0x11, 96);
+    }
+    allocator.free_batch(ptrs.data(), burst);
+
+    // the burst comes back from the thread cache as a whole
+    std::array<void*, burst> again{};
+    assert(allocator.alloc_batch(96, 32, burst, again.data()) == burst);
+    std::vector<void*> reused(again.begin(), again.end());
+    std::sort(reused.begin(), reused.end());
+    assert(reused == sorted);
+
+    // a burst freed on another thread reaches this thread's inbox in one go
+    std::thread consumer([&] { allocator.free_batch(again.data(), burst); });
+    consumer.join();
+    assert(allocator.alloc_batch(96, 32, burst, ptrs.data()) == burst);
+    std::sort(ptrs.begin(), ptrs.end());
+    assert(std::vector<void*>(ptrs.begin(), ptrs.end()) == sorted);
+
+    // mixed small and large blocks, with holes
+    std::array<void*, 4> mixed{allocator.alloc(16, 1), nullptr, allocator.alloc(100 * 1000, 1), ptrs[0]};
+    allocator.free_batch(mixed.data(), mixed.size());
+    allocator.free_batch(ptrs.data() + 1, burst - 1);
+    assert(allocator.alloc_batch(20 * 1000, 1, 3, mixed.data()) == 3);
+    allocator.free_batch(mixed.data(), 3);
+}
+
+static void test_pmr_adapters() {
+    slab allocator;
+
+    // sized free: the block goes back to this thread's cache like an unsized one
+    void* p = allocator.alloc(200, 64);
+    allocator.free(p, 200, 64);
+    assert(allocator.alloc(200, 64) == p);
+    allocator.free(p, 200, 64);
+    void* big = allocator.alloc(300 * 1000, 128);
+    allocator.free(big, 300 * 1000, 128);
+    assert(allocator.alloc(300 * 1000, 128) == big);
+    allocator.free(big);
+
+    slab_resource resource(allocator);
+    {
+        std::pmr::vector<std::pmr::string> strings(&resource);
+        std::pmr::list<int> nodes(&resource);
+        std::pmr::unordered_map<int, int> map(&resource);
+        for (int i = 0; i < 10000; ++i) {
+            strings.emplace_back(static_cast<std::size_t>(i % 300), 'a');
+            nodes.push_back(i);
+            map[i] = i;
+        }
+        for (int i = 0; i < 10000; i += 2) { map.erase(i); nodes.pop_front(); }
+        assert(map.size() == 5000 && nodes.front() == 5000 && strings[299].size() == 299);
+        struct alignas(256) Wide { char bytes[256]; };
+        void* wide = resource.allocate(sizeof(Wide), alignof(Wide));
+        assert(reinterpret_cast<std::uintptr_t>(wide) % 256 == 0);
+        resource.deallocate(wide, sizeof(Wide), alignof(Wide));
+    }
+    assert(resource.is_equal(resource));
+    slab_resource other(allocator);
+    assert(!resource.is_equal(other));
+
+    // node containers through the allocator adapter, freed on another thread
+    using Alloc = slab_allocator<std::pair<const int, std::list<int, slab_allocator<int>>>>;
+    auto* map = new std::unordered_map<int, std::list<int, slab_allocator<int>>, std::hash<int>,
+                                       std::equal_to<int>, Alloc>(0, std::hash<int>{}, std::equal_to<int>{}, Alloc(allocator));
+    for (int i = 0; i < 2000; ++i) {
+        (*map).try_emplace(i, slab_allocator<int>(allocator)).first->second.assign(static_cast<std::size_t>(i % 17), i);
+    }
+    assert(slab_allocator<int>(allocator) == Alloc(allocator));
+    std::thread consumer([&] { delete map; });
+    consumer.join();
+}
+
+static void test_compile_time_fast_path() {
+    slab allocator;
+
+    // same class as the runtime path, so blocks move freely between the two
+    void* p = allocator.alloc<200, 64>();
+    assert(p && reinterpret_cast<std::uintptr_t>(p) % 64 == 0);
+    assert(allocator.usable_size(p) == allocator.usable_size(allocator.alloc(200, 64)));
+    allocator.free<200, 64>(p);
+    assert(allocator.alloc(200, 64) == p);
+    allocator.free(p);
+    assert((allocator.alloc<200, 64>() == p));
+    allocator.free<200, 64>(p);
+    allocator.free<200, 64>(nullptr);
+
+    // past the limit, the surplus is released like any other free
+    std::vector<void*> many(5000);
+    for (void*& b : many) { b = allocator.alloc<32>(); assert(b); }
+    for (void* b : many) { allocator.free<32>(b); }
+
+    // large sizes and remote frees fall back to the runtime paths
+    void* big = allocator.alloc<100 * 1000, 256>();
+    assert(big && reinterpret_cast<std::uintptr_t>(big) % 256 == 0);
+    std::thread remote([&] { allocator.free<100 * 1000, 256>(big); allocator.free<32>(many[0]); });
+    remote.join();
+    many[0] = allocator.alloc<32>();
+    assert(many[0]);
+    allocator.free<32>(many[0]);
+
+    static int alive = 0;
+    struct alignas(64) Order {
+        std::uint64_t id;
+        char tag[40];
+        explicit Order(std::uint64_t id) : id(id), tag{} { ++alive; }
+        ~Order() { --alive; }
+    };
+    object_pool<Order> orders(allocator);
+    std::vector<Order*> live;
+    for (std::uint64_t i = 0; i < 1000; ++i) {
+        Order* o = orders.create(i);
+        assert(o && reinterpret_cast<std::uintptr_t>(o) % 64 == 0 && o->id == i);
+        live.push_back(o);
+    }
+    assert(alive == 1000);
+    for (Order* o : live) { orders.destroy(o); }
+    assert(alive == 0);
+    assert(orders.create(7u) == live.back());
+    orders.destroy(live.back());
+}
+
+// Order-book style: small messages, 16KB slabs, deep refills for the smallest classes.
+struct small_message_config : default_config {
+    static constexpr std::size_t class_small_max = 256;
+    static constexpr std::size_t max_small_size = 1024;
+    static constexpr std::size_t page_size = 16 * 1024;
+    static constexpr std::uint32_t refill_batch(std::size_t size) noexcept { return size <= 128 ? 256 : 64; }
+};
+
+// Logging style: coarse buffer classes up to 16KB, 256KB slabs, shallow caches.
+struct log_buffer_config : default_config {
+    static constexpr std::size_t class_small_step = 64;
+    static constexpr std::size_t class_small_max = 512;
+    static constexpr std::size_t max_small_size = 16 * 1024;
+    static constexpr std::size_t page_size = 256 * 1024;
+    static constexpr std::uint32_t refill_batch(std::size_t) noexcept { return 16; }
+    static constexpr std::uint32_t cache_max_batches = 2;
+};
+
+// Keeps the calling thread (and threads it starts) on its current CPU; restores on scope exit.
+struct PinToCpu {
+    cpu_set_t saved;
+    PinToCpu() {
+        sched_getaffinity(0, sizeof(saved), &saved);
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(sched_getcpu(), &one);
+        sched_setaffinity(0, sizeof(one), &one);
+    }
+    ~PinToCpu() { sched_setaffinity(0, sizeof(saved), &saved); }
+};
+
+static void test_per_cpu_caches() {
+    PinToCpu pin;
+    struct alignas(16) Block { std::byte bytes[16]; };
+
+    // list ops with restartable sequences (when the kernel has them) and with the fallback
+    for (bool use_rseq : {true, false}) {
+        auto lists = std::make_unique<CpuCaches<per_cpu_config>>(use_rseq);
+        assert(lists->uses_rseq() == (use_rseq && rseq_available()));
+        std::vector<Block> blocks(5);
+        assert(lists->pop(0) == nullptr);
+        for (int i = 0; i < 3; ++i) { assert(lists->push(0, &blocks[i], 3)); }
+        assert(!lists->push(0, &blocks[3], 3)); // full
+        assert(lists->pop(0) == &blocks[2]);
+        assert(lists->push(0, &blocks[2], 3));
+
+        FreeNode* chain = lists->take_all(0);
+        assert(chain == reinterpret_cast<FreeNode*>(&blocks[2]) && lists->pop(0) == nullptr);
+        assert(lists->fill(0, chain) && !lists->fill(0, chain));
+        assert(!lists->push(0, &blocks[3], 3)); // fill counted the chain
+
+        // a full list hands its top two on and keeps the new block over the rest
+        FreeNode* spill = lists->push_overflow(0, &blocks[4], 2);
+        assert(spill == reinterpret_cast<FreeNode*>(&blocks[2]) && spill->next == reinterpret_cast<FreeNode*>(&blocks[1]));
+        assert(spill->next->next == nullptr);
+        assert(lists->pop(0) == &blocks[4] && lists->pop(0) == &blocks[0] && lists->pop(0) == nullptr);
+    }
+
+    basic_slab<per_cpu_config> allocator;
+
+    // threads hold no blocks of their own: one exiting thread's frees serve the next
+    void* freed = nullptr;
+    std::thread([&] { freed = allocator.alloc(64, 1); allocator.free(freed); }).join();
+    std::thread([&] { void* p = allocator.alloc(64, 1); assert(p == freed); allocator.free(p); }).join();
+    assert((allocator.alloc<64, 16>() == freed));
+    allocator.free<64, 16>(freed);
+
+    // oversubscribed churn with cross-thread frees, large blocks included
+    constexpr int threads = 16;
+    constexpr int rounds = 4000;
+    std::vector<std::vector<void*>> handoff(threads);
+    std::barrier sync(threads);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            std::mt19937 rng(static_cast<unsigned>(t + 7));
+            std::vector<void*> live;
+            for (int i = 0; i < rounds; ++i) {
+                const std::size_t size = 16 + rng() % (i % 97 == 0 ? 20000 : 2000);
+                auto* p = static_cast<unsigned char*>(allocator.alloc(size, 1));
+                assert(p != nullptr && allocator.usable_size(p) >= size);
+                p[0] = static_cast<unsigned char>(t);
+                p[size - 1] = static_cast<unsigned char>(t);
+                live.push_back(p);
+                if (live.size() > 64) {
+                    const std::size_t victim = rng() % live.size();
+                    assert(*static_cast<unsigned char*>(live[victim]) == static_cast<unsigned char>(t));
+                    allocator.free(live[victim]);
+                    live[victim] = live.back();
+                    live.pop_back();
+                }
+            }
+            handoff[t] = std::move(live);
+            sync.arrive_and_wait();
+            for (void* p : handoff[(t + 1) % threads]) { allocator.free(p); } // remote frees
+        });
+    }
+    for (auto& th : workers) { th.join(); }
+
+    std::vector<void*> batch(300);
+    assert(allocator.alloc_batch(48, 16, batch.size(), batch.data()) == batch.size());
+    std::sort(batch.begin(), batch.end());
+    assert(std::adjacent_find(batch.begin(), batch.end()) == batch.end());
+    allocator.free_batch(batch.data(), batch.size());
+    allocator.trim();
+}
+
+static void test_policy_configs() {
+    using Book = config_traits<small_message_config>;
+    using Logs = config_traits<log_buffer_config>;
+    static_assert(Book::NumClasses == 24 && Book::sizes.back() == 1024 && Book::batch[0] == 256 && Book::batch.back() == 64);
+    static_assert(Logs::sizes[0] == 64 && Logs::batch[5] == 16 && Logs::cache_max_length[5] == 32);
+
+    basic_slab<small_message_config> book;
+    basic_slab<log_buffer_config> logs;
+    slab plain;
+
+    // each slab uses its own class table and page size
+    void* msg = book.alloc(100, 1);
+    void* line = logs.alloc(100, 1);
+    void* other = plain.alloc(100, 1);
+    assert(book.usable_size(msg) == 112 && logs.usable_size(line) == 128 && plain.usable_size(other) == 112);
+    assert(span_of<Book::page_size>(msg)->size_class == Book::get_bucket(100, 1));
+    assert(reinterpret_cast<std::uintptr_t>(span_of<Logs::page_size>(line)) % Logs::page_size == 0);
+    void* buffer = logs.alloc(10000, 1);
+    assert(logs.usable_size(buffer) == 10240 && span_of<Logs::page_size>(buffer)->size_class < Logs::NumClasses);
+    void* past = book.alloc(2000, 1); // past this config's max_small_size: its large tier
+    assert(span_of<Book::page_size>(past)->size_class == Book::large_class && book.usable_size(past) >= 2000);
+    book.free(msg);
+    logs.free(line);
+    plain.free(other);
+    logs.free(buffer);
+    book.free(past);
+
+    // interleaved use of all three on one thread, and frees from another thread
+    std::vector<void*> book_blocks;
+    std::vector<void*> log_blocks;
+    std::vector<void*> plain_blocks;
+    for (std::size_t i = 0; i < 6000; ++i) {
+        book_blocks.push_back(book.alloc(16 + i % 1000, 1));
+        log_blocks.push_back(logs.alloc(64 + i % 16000, 64));
+        plain_blocks.push_back(plain.alloc(16 + i % 4000, 1));
+        std::memset(book_blocks.back(), 1, 16);
+        std::memset(log_blocks.back(), 2, 64);
+        assert(reinterpret_cast<std::uintptr_t>(log_blocks.back()) % 64 == 0);
+    }
+    std::thread remote([&] {
+        for (void* p : book_blocks) { book.free(p); }
+        for (void* p : log_blocks) { logs.free(p); }
+    });
+    remote.join();
+    for (void* p : plain_blocks) { plain.free(p); }
+    logs.trim();
+
+    // compile-time paths and typed pools over a tuned slab
+    struct Quote { std::uint64_t px; std::uint32_t qty; };
+    object_pool<Quote, basic_slab<small_message_config>> quotes(book);
+    Quote* q = quotes.create(Quote{101, 5});
+    assert(q->px == 101 && book.usable_size(q) == 16);
+    quotes.destroy(q);
+    assert(quotes.create(Quote{102, 1}) == q);
+    quotes.destroy(q);
+}
+
+// Runs as `test_runner preload_child` under LD_PRELOAD=libslab_malloc.so.
+static int run_preload_child() {
+    // served by the slab: a 100-byte request lands in the 112-byte class
+    void* probe = std::malloc(100);
+    assert(malloc_usable_size(probe) == 112);
+    std::free(probe);
+
+    // impossible sizes fail as malloc should, not as a small block
+    errno = 0;
+    assert(std::malloc(SIZE_MAX) == nullptr && errno == ENOMEM);
+    errno = 0;
+    assert(std::calloc(1, SIZE_MAX - 3) == nullptr && errno == ENOMEM);
+
+    // a large calloc is not committed until it is written
+    const std::size_t before = resident_bytes();
+    auto* zeroed = static_cast<unsigned char*>(std::calloc(1, 16 * 1024 * 1024));
+    assert(zeroed != nullptr && resident_bytes() < before + 4 * 1024 * 1024);
+    assert(zeroed[0] == 0 && zeroed[16 * 1024 * 1024 - 1] == 0);
+    std::free(zeroed);
+
+    auto churn = [](int seed) {
+        std::mt19937 rng{static_cast<std::mt19937::result_type>(seed)};
+        std::map<int, std::string> nodes;
+        std::vector<std::unique_ptr<std::vector<int>>> vecs;
+        for (int i = 0; i < 20000; ++i) {
+            nodes[static_cast<int>(rng() % 4096)] = std::string(rng() % 200, 'x');
+            vecs.push_back(std::make_unique<std::vector<int>>(rng() % 300));
+            if (vecs.size() > 64) { vecs.erase(vecs.begin()); }
+
+            struct alignas(128) Simd { float lanes[32]; };
+            auto simd = std::make_unique<Simd>();
+            assert(reinterpret_cast<std::uintptr_t>(simd.get()) % 128 == 0);
+
+            void* p = std::calloc(1 + rng() % 64, 16);
+            assert(static_cast<unsigned char*>(p)[0] == 0);
+            p = std::realloc(p, 1 + rng() % 20000);
+            std::free(p);
+
+            void* page = nullptr;
+            assert(posix_memalign(&page, 4096, 100) == 0 && reinterpret_cast<std::uintptr_t>(page) % 4096 == 0);
+            std::free(page);
+            void* big = std::aligned_alloc(64, 3 * 1024 * 1024);
+            std::memset(big, 1, 4096);
+            std::free(big);
+        }
+    };
+
+    // blocks handed between threads, while another thread forks
+    std::vector<std::string*> handoff(4096);
+    std::thread producer([&] { for (auto& s : handoff) { s = new std::string(100, 'p'); } });
+    producer.join();
+    std::thread consumer([&] { for (auto* s : handoff) { delete s; } });
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 3; ++t) { workers.emplace_back(churn, t); }
+
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        churn(99);
+        ::_exit(0);
+    }
+    int status = 0;
+    ::waitpid(pid, &status, 0);
+    consumer.join();
+    for (auto& w : workers) { w.join(); }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : 1;
+}
+
+static void test_preload_interposer() {
+    char exe[4096] = {};
+    const ssize_t len = ::readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    assert(len > 0);
+    std::string dir(exe, static_cast<std::size_t>(len));
+    dir.erase(dir.rfind('/'));
+    const std::string preload = "LD_PRELOAD=" + dir + "/libslab_malloc.so ";
+    assert(::access((dir + "/libslab_malloc.so").c_str(), R_OK) == 0);
+
+    assert(std::system((preload + std::string(exe, static_cast<std::size_t>(len)) + " preload_child").c_str()) == 0);
+    // unmodified binaries, pipes and forks included
+    assert(std::system((preload + "sh -c 'ls / | sort | wc -l' > /dev/null").c_str()) == 0);
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "preload_child") == 0) { return run_preload_child(); }
+
+    const std::array<TestCase, 32> tests{{
         {"basic", test_basic},
         {"alignment_single_thread", test_alignment_single_thread},
         {"remote_free_two_threads", test_remote_free_two_threads},
         {"four_thread_stress", test_four_thread_stress},
         {"multithread_alignment", test_multithread_alignment},
+        {"remote_free_many_owners", test_remote_free_many_owners},
+        {"remote_free_batched_flush", test_remote_free_batched_flush},
+        {"return_rings", test_return_rings},
+        {"remote_draining_is_incremental", test_remote_draining_is_incremental},
+        {"frees_to_exited_owner", test_frees_to_exited_owner},
+        {"alloc_after_thread_exit", test_alloc_after_thread_exit},
+        {"adopt_mode_keeps_remote_blocks", test_adopt_mode_keeps_remote_blocks},
+        {"thread_exit_recycles_blocks_and_ids", test_thread_exit_recycles_blocks_and_ids},
+        {"transfer_cache_moves_batches", test_transfer_cache_moves_batches},
+        {"thread_cache_limits_adapt", test_thread_cache_limits_adapt},
+        {"refill_sizes_adapt", test_refill_sizes_adapt},
+        {"concurrent_refills_distinct_blocks", test_concurrent_refills_distinct_blocks},
+        {"trim_releases_empty_pages", test_trim_releases_empty_pages},
+        {"background_maintenance", test_background_maintenance},
+        {"page_backings", test_page_backings},
+        {"blocks_packed_at_natural_alignment", test_blocks_packed_at_natural_alignment},
+        {"size_class_lookup_is_tight", test_size_class_lookup_is_tight},
+        {"power_of_two_alignments", test_power_of_two_alignments},
+        {"large_objects", test_large_objects},
+        {"alloc_zeroed", test_alloc_zeroed},
+        {"batch_alloc_free", test_batch_alloc_free},
+        {"out_of_memory_returns_null", test_out_of_memory_returns_null},
+        {"preload_interposer", test_preload_interposer},
+        {"pmr_adapters", test_pmr_adapters},
+        {"compile_time_fast_path", test_compile_time_fast_path},
+        {"policy_configs", test_policy_configs},
+        {"per_cpu_caches", test_per_cpu_caches},
     }};
 
     int failures = 0;